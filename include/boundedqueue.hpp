@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace trm {
+
+// Fixed-capacity lock-free MPMC queue (Vyukov). Push fails instead of blocking when full.
+template <typename T, std::size_t N> class BoundedQueue {
+    static_assert(N && !(N & (N - 1)), "BoundedQueue capacity must be a power of two.");
+    struct Cell {
+        std::atomic<std::size_t> sequence{};
+        T value{};
+    };
+    std::array<Cell, N> cells{};
+    alignas(64) std::atomic<std::size_t> enqueuePos{};
+    alignas(64) std::atomic<std::size_t> dequeuePos{};
+
+  public:
+    BoundedQueue() {
+        for (std::size_t i{}; i < N; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(T value) {
+        std::size_t pos{enqueuePos.load(std::memory_order_relaxed)};
+        while (true) {
+            Cell &cell{cells[pos & (N - 1)]};
+            const std::size_t seq{cell.sequence.load(std::memory_order_acquire)};
+            const std::intptr_t diff{static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos)};
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> pop() {
+        std::size_t pos{dequeuePos.load(std::memory_order_relaxed)};
+        while (true) {
+            Cell &cell{cells[pos & (N - 1)]};
+            const std::size_t seq{cell.sequence.load(std::memory_order_acquire)};
+            const std::intptr_t diff{static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1)};
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> out{std::move(cell.value)};
+                    cell.value = T{};
+                    cell.sequence.store(pos + N, std::memory_order_release);
+                    return out;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate under concurrent use.
+    bool empty() const {
+        return enqueuePos.load(std::memory_order_acquire) == dequeuePos.load(std::memory_order_acquire);
+    }
+};
+
+} // namespace trm
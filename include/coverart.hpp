@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace trm {
+
+// Cover art constants. Thumbnails are drawn with half-block glyphs, so one cell holds two pixels vertically.
+struct CoverArtSpecifiers {
+    static constexpr int columns{32};
+    static constexpr int rows{16};
+    static constexpr int pixelWidth{columns};
+    static constexpr int pixelHeight{rows * 2};
+    static constexpr std::size_t memoryBudget{4 * 1024 * 1024};
+    static constexpr std::size_t entryOverhead{256};
+    static constexpr std::uint32_t cacheMagic{0x54504D54}; // "TMPT"
+    static constexpr std::uint32_t cacheVersion{1};
+    static constexpr std::array<const char *, 8> folderImages{
+        "cover.jpg", "cover.png", "folder.jpg", "folder.png", "front.jpg", "front.png", "album.jpg", "album.png",
+    };
+};
+
+// Packed RGB24 image, at most pixelWidth x pixelHeight.
+struct Thumbnail {
+    int width{};
+    int height{};
+    std::vector<std::uint8_t> rgb{};
+    const std::uint8_t *pixel(const int x, const int y) const { return rgb.data() + (y * width + x) * 3; }
+};
+
+// Background cover art loader with a memory-bounded LRU and an on-disk thumbnail cache.
+// Every public method is non-blocking apart from brief map access; decoding happens on the worker.
+class CoverArtCache {
+    struct Entry {
+        std::shared_ptr<const Thumbnail> thumb{}; // Null when the track has no art.
+        std::list<std::string>::iterator lru{};
+        std::size_t bytes{};
+    };
+    std::filesystem::path cacheDir{};
+    std::function<void()> onReady{};
+    std::mutex mutex{};
+    std::condition_variable condition{};
+    std::unordered_map<std::string, Entry> entries{};
+    std::list<std::string> lru{};
+    std::size_t usedBytes{};
+    std::deque<std::filesystem::path> urgent{};
+    std::deque<std::filesystem::path> prefetched{};
+    std::unordered_set<std::string> queued{};
+    std::string inFlight{};
+    bool inFlightWanted{};
+    bool terminate{};
+    std::thread worker{};
+    void workerThread();
+    void insert(const std::string &key, std::shared_ptr<const Thumbnail> thumb);
+    std::shared_ptr<const Thumbnail> produce(const std::filesystem::path &track);
+    std::filesystem::path diskPath(const std::filesystem::path &track) const;
+
+  public:
+    std::shared_ptr<const Thumbnail> get(const std::filesystem::path &track);
+    void prefetch(const std::vector<std::filesystem::path> &tracks);
+    CoverArtCache(std::function<void()> ready);
+    ~CoverArtCache();
+};
+
+} // namespace trm
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <optional>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -74,6 +77,7 @@ class Decoder {
     std::filesystem::path& getFilePath() { return data.path; }
     void seekTo(const float timestamp);
     std::optional<std::int16_t> getSample();
+    std::size_t getSamples(std::int16_t *out, const std::size_t count);
     Decoder() {};
     Decoder(const std::filesystem::path path);
 };
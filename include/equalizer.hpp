@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace trm {
+
+// Equalizer constants.
+struct EqSpecifiers {
+    static constexpr std::size_t maxBands{10};
+    static constexpr std::size_t blockFrames{64};
+    static constexpr float smoothing{0.15f}; // Per-block coefficient approach rate, ~9 ms time constant.
+    static constexpr float minFrequency{10.0f};
+    static constexpr float minQ{0.1f};
+    static constexpr float maxQ{24.0f};
+};
+
+// Biquad response types (RBJ cookbook).
+enum class FilterType : std::uint8_t {
+    PEAK,
+    LOW_SHELF,
+    HIGH_SHELF,
+    LOW_PASS,
+    HIGH_PASS,
+};
+
+// User-facing band parameters.
+struct EqBand {
+    FilterType type{FilterType::PEAK};
+    float frequency{1000.0f};
+    float gain{0.0f};
+    float q{0.707f};
+    bool enabled{};
+};
+
+// Normalized transposed direct form II coefficients.
+struct BiquadCoeffs {
+    float b0{1.0f};
+    float b1{};
+    float b2{};
+    float a1{};
+    float a2{};
+};
+
+// Band parameter slot. Written by any thread, read by the decode thread.
+struct EqBandSlot {
+    std::atomic<FilterType> type{FilterType::PEAK};
+    std::atomic<float> frequency{1000.0f};
+    std::atomic<float> gain{};
+    std::atomic<float> q{0.707f};
+    std::atomic<bool> enabled{};
+};
+
+// Per-band filter memory. Lanes are { L, R, -, - } so both channels step together.
+struct alignas(16) BiquadState {
+    std::array<float, 4> z1{};
+    std::array<float, 4> z2{};
+};
+
+// Parametric equalizer for interleaved stereo s16.
+// setBand()/setEnabled() are lock-free and may be called from any thread.
+// process()/reset() must only be called from the decode thread.
+class Equalizer {
+    std::array<EqBandSlot, EqSpecifiers::maxBands> slots{};
+    std::atomic<std::uint32_t> generation{};
+    std::atomic<bool> enabled{true};
+    std::uint32_t seenGeneration{};
+    std::array<BiquadCoeffs, EqSpecifiers::maxBands> target{};
+    std::array<BiquadCoeffs, EqSpecifiers::maxBands> current{};
+    std::array<BiquadState, EqSpecifiers::maxBands> memory{};
+    std::array<bool, EqSpecifiers::maxBands> live{};
+    void refreshTargets();
+    void smoothCoefficients();
+    void processBlock(float *samples, const std::size_t frames);
+
+  public:
+    static BiquadCoeffs design(const EqBand &band, const float sampleRate);
+    void setBand(const std::size_t idx, const EqBand &band);
+    EqBand getBand(const std::size_t idx) const;
+    void setEnabled(const bool value);
+    bool isEnabled() const { return enabled.load(); }
+    void reset();
+    void process(std::int16_t *samples, const std::size_t count);
+};
+
+} // namespace trm
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace trm {
+
+// Export configuration.
+struct ExportOptions {
+    static constexpr std::size_t writeAlignment{4096};
+    static constexpr std::size_t minBufferSize{64 * 1024};
+    std::vector<std::filesystem::path> inputs{};
+    std::filesystem::path outputDir{};
+    std::size_t threads{};
+    std::size_t memoryBudget{64 * 1024 * 1024};
+};
+
+// Aggregate results of a batch run.
+struct ExportStats {
+    std::size_t files{};
+    std::size_t failed{};
+    std::uint64_t bytesWritten{};
+    double audioSeconds{};
+    double wallSeconds{};
+    double realtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+    double mbPerSecond() const { return wallSeconds > 0.0 ? bytesWritten / (1024.0 * 1024.0) / wallSeconds : 0.0; }
+};
+
+// Page-aligned write buffer. One per worker, reused across files.
+struct AlignedBuffer {
+    struct Deleter {
+        void operator()(std::byte *p) const {
+            ::operator delete[](p, std::align_val_t{ExportOptions::writeAlignment});
+        }
+    };
+    std::unique_ptr<std::byte[], Deleter> data{};
+    std::size_t size{};
+    AlignedBuffer() {};
+    AlignedBuffer(const std::size_t bytes);
+};
+
+// Streams interleaved s16 PCM to a RIFF/WAVE file through a caller-provided buffer.
+class WavWriter {
+    std::filesystem::path target{};
+    std::filesystem::path partial{};
+    std::unique_ptr<std::FILE, decltype([](std::FILE *f) { std::fclose(f); })> file{};
+    AlignedBuffer &buffer;
+    std::size_t used{};
+    std::uint64_t dataBytes{};
+    void writeHeader();
+    void flush();
+
+  public:
+    std::int16_t *writePtr() { return reinterpret_cast<std::int16_t *>(buffer.data.get() + used); }
+    std::size_t writeCapacity() const { return (buffer.size - used) / sizeof(std::int16_t); }
+    void commit(const std::size_t samples);
+    std::uint64_t finish();
+    WavWriter(const std::filesystem::path &path, AlignedBuffer &buffer);
+    ~WavWriter();
+};
+
+// Headless batch decoder. Decodes every input to WAV concurrently, one Decoder per task.
+class BatchExporter {
+    ExportOptions options{};
+    std::vector<std::filesystem::path> outputPaths() const;
+
+  public:
+    ExportStats run();
+    BatchExporter(ExportOptions opts);
+};
+
+} // namespace trm
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ftxui/component/component.hpp>
+#include <ftxui/component/event.hpp>
+#include <ftxui/component/screen_interactive.hpp>
+#include <ftxui/dom/elements.hpp>
+
+#include "coverart.hpp"
+#include "maudio.hpp"
+#include "playlist.hpp"
+
+namespace trm {
+
+// Interface constants.
+struct InterfaceSpecifiers {
+    static constexpr std::chrono::milliseconds activeFrame{33};
+    static constexpr std::chrono::milliseconds idleFrame{500};
+    static constexpr float seekStep{5.0f};
+    static constexpr float volumeStep{0.05f};
+};
+
+// Terminal frontend.
+// Rendering only ever reads AudioDevice snapshots, and input only issues non-blocking commands.
+class Interface {
+    AudioDevice &device;
+    std::vector<std::filesystem::path> library{}; // Scanned files, listed ahead of the playlist's entries.
+    std::optional<Playlist> playlist{};
+    PlayQueue queue;
+    ftxui::ScreenInteractive screen;
+    CoverArtCache art;
+    std::thread refreshThread{};
+    std::mutex refreshMutex{};
+    std::condition_variable refreshCondition{};
+    bool terminate{};
+    bool wasReady{};
+    std::size_t selected{};
+    std::size_t playing{};
+    std::string notice{};
+    void refreshLoop();
+    void stopRefresh();
+    std::size_t trackCount() const;
+    std::filesystem::path trackAt(const std::size_t idx) const;
+    void playIndex(const std::size_t idx);
+    void playNext();
+    void prefetchVisible();
+    std::size_t visibleRows() const;
+    void onSnapshot(const PlayerSnapshot &snap);
+    bool onEvent(const ftxui::Event &event);
+    bool onPlaylistEvent(const ftxui::Event &event);
+    ftxui::Element render();
+    ftxui::Element renderArt(const Thumbnail *thumb) const;
+
+  public:
+    void run();
+    Interface(AudioDevice &dev, const std::vector<std::filesystem::path> &paths);
+    ~Interface();
+};
+
+} // namespace trm
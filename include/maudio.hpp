@@ -1,17 +1,23 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <mutex>
 #include <optional>
 #include <queue>
+#include <string>
+#include <thread>
 
+#include "boundedqueue.hpp"
 #include "decoder.hpp"
+#include "equalizer.hpp"
 #include "miniaudio.h"
+#include "seqlock.hpp"
+#include "telemetry.hpp"
 
 /**
     NOTE:
@@ -33,12 +39,15 @@ struct MaDeviceSpecifiers {
     static constexpr std::size_t queueLimit{
         static_cast<std::size_t>(sampleRate * channels * static_cast<float>(queueLimitMs.count()) / 1000)
     };
+    static constexpr std::size_t commandCapacity{8};
 };
 
 // Miniaudio device.
 struct MaDevice {
     ma_device_config devConfig{};
     ma_device dev{};
+    ma_context context{};
+    bool ownsContext{};
     static void callback(ma_device *device, void *out, const void *in, unsigned int frames);
 };
 
@@ -67,6 +76,30 @@ struct Command {
     std::optional<std::filesystem::path> pVal{};
 };
 
+// Player state as seen by readers. Published as a whole through a SeqLock.
+struct PlayerSnapshot {
+    static constexpr std::size_t maxPathBytes{512};
+    float timestamp{};
+    float duration{};
+    float volume{};
+    std::uint64_t trackId{};
+    std::uint64_t underruns{};
+    std::uint64_t droppedCommands{};
+    std::uint32_t queuedSamples{};
+    std::uint32_t pathBytes{};
+    bool playback{};
+    bool muted{};
+    bool looping{};
+    bool ready{};
+    bool eof{true};
+    std::array<char, maxPathBytes> path{};
+    void setPath(const std::string &u8);
+    std::filesystem::path filePath() const {
+        return std::u8string{reinterpret_cast<const char8_t *>(path.data()), pathBytes};
+    }
+    bool operator==(const PlayerSnapshot &) const = default;
+};
+
 // Device state.
 struct DeviceState {
     FileDataAtomic data{};
@@ -76,19 +109,27 @@ struct DeviceState {
     std::atomic<bool> terminate{};
     std::atomic<bool> looping{};
     std::atomic<bool> eof{true};
+    std::atomic<bool> primed{}; // The sample queue has held samples since its last flush.
     std::atomic<float> volume{};
     std::atomic<std::size_t> cQueueSamples{};
+    std::atomic<std::uint32_t> wakeups{};
+    std::atomic<std::uint64_t> underruns{};
+    std::atomic<std::uint64_t> droppedCommands{};
+    std::atomic<PlaybackTelemetry *> telemetry{};
+    std::uint64_t trackHash{};
     std::mutex queueMutex{};
-    std::mutex commandMutex{};
-    std::queue<Command> commandQueue{};
+    BoundedQueue<Command, MaDeviceSpecifiers::commandCapacity> commandQueue{};
     std::queue<std::int16_t> sampleQueue{};
     std::queue<std::int16_t> stagingQueue{};
-    std::condition_variable condition{};
     Decoder decoder{};
+    Equalizer equalizer{};
+    PlayerSnapshot published{};
+    SeqLock<PlayerSnapshot> snapshot{};
     void flushSampleQueue();
     void flushStagingQueue();
     void qPushSync(std::int16_t sample);
     void qPopSync();
+    void wake();
 };
 
 // Playback device.
@@ -109,12 +150,16 @@ class AudioDevice {
     void seekTo(const Command &command);
     void start(const Command &command);
     void end(const Command &command);
+    void dropTrack();
+    void publishSnapshot();
+    void record(const PlaybackEventType type, const float position, const float value);
+    void recordStop();
     friend struct MaDevice;
 
   public:
     std::mutex &getQueueMutex() { return state.queueMutex; }
     std::queue<std::int16_t> &getQueue() { return state.sampleQueue; }
-    AudioDevice();
+    AudioDevice(const std::optional<ma_backend> backend = std::nullopt);
     void play();
     void pause();
     void togglePlayback();
@@ -126,10 +171,19 @@ class AudioDevice {
     void seekTo(const float timestamp);
     void start(const std::filesystem::path path);
     void end();
+    void setEqBand(const std::size_t idx, const EqBand &band) { state.equalizer.setBand(idx, band); }
+    EqBand getEqBand(const std::size_t idx) const { return state.equalizer.getBand(idx); }
+    void setEqEnabled(const bool value) { state.equalizer.setEnabled(value); }
+    void setTelemetry(PlaybackTelemetry *sink) { state.telemetry.store(sink); }
+    PlayerSnapshot getSnapshot() const { return state.snapshot.load(); }
+    std::uint64_t getSnapshotVersion() const { return state.snapshot.version(); }
     float getDuration() { return state.data.duration.load(); }
     float getTimestamp() { return state.data.timestamp.load(); }
     bool isEof() { return state.eof.load(); }
-    std::filesystem::path getFilePath() { return state.ready.load() ? state.data.path : ""; }
+    std::filesystem::path getFilePath() {
+        const PlayerSnapshot snap{getSnapshot()};
+        return snap.ready ? snap.filePath() : "";
+    }
     ~AudioDevice();
 };
 
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace trm {
+
+// Playlist constants.
+struct PlaylistSpecifiers {
+    static constexpr std::uint32_t snapshotMagic{0x53504D54}; // "TMPS"
+    static constexpr std::uint32_t journalMagic{0x4A504D54};  // "TMPJ"
+    static constexpr std::uint32_t version{2};
+    static constexpr std::uint32_t maxEntryBytes{1 << 16};
+    static constexpr std::uint32_t noOrigin{UINT32_MAX};
+};
+
+// Append-only deduplicated string storage. Ids stay valid until clear().
+class StringPool {
+    std::string arena{};
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> spans{}; // Offset, length.
+    std::unordered_map<std::uint64_t, std::uint32_t> index{};
+    void reindex();
+    friend class Playlist;
+
+  public:
+    std::uint32_t intern(const std::string_view value);
+    std::string_view view(const std::uint32_t id) const {
+        return std::string_view{arena}.substr(spans[id].first, spans[id].second);
+    }
+    std::size_t size() const { return spans.size(); }
+    std::size_t bytes() const { return arena.size(); }
+    void clear();
+};
+
+// Playlist entry. The directory part is interned separately so an album costs one copy of its path.
+struct PlaylistEntry {
+    std::uint32_t dir{};
+    std::uint32_t file{};
+    std::uint32_t origin{PlaylistSpecifiers::noOrigin}; // Index in the source's track array, if it came from there.
+};
+
+// Journaled playlist edit.
+enum class PlaylistOp : std::uint8_t {
+    INSERT,
+    REMOVE,
+    MOVE,
+};
+
+// JSON playlist, either `["path", ...]` or `{"name": "...", "tracks": ["path" | {"path": "..."}, ...]}`.
+// Relative paths resolve against the playlist's directory.
+// The parsed form is cached as a binary snapshot keyed on the file's size and mtime. Edits are appended to
+// a journal in the data directory and replayed on load; save() writes them back into the JSON, keeping any fields
+// the player does not read.
+class Playlist {
+    std::filesystem::path source{};
+    std::string name{};
+    StringPool pool{};
+    std::vector<PlaylistEntry> entries{};
+    std::filesystem::path snapshotPath{};
+    std::filesystem::path journalPath{};
+    std::ofstream journal{};
+    std::size_t journalOps{};
+    std::uint64_t stamp{}; // Identifies the source file revision the snapshot and journal apply to.
+    std::uint64_t sourceStamp() const;
+    void parse();
+    bool readSnapshot();
+    void writeSnapshot() const;
+    void replayJournal();
+    void resetJournal();
+    void log(const PlaylistOp op, const std::uint32_t a, const std::uint32_t b, const std::string_view track);
+    void applyInsert(
+        const std::size_t idx, const std::string_view track, const std::uint32_t origin = PlaylistSpecifiers::noOrigin
+    );
+    void applyRemove(const std::size_t idx);
+    void applyMove(const std::size_t from, const std::size_t to);
+    friend struct PlaylistSax;
+
+  public:
+    const std::string &getName() const { return name; }
+    std::size_t size() const { return entries.size(); }
+    std::string entry(const std::size_t idx) const;
+    std::filesystem::path at(const std::size_t idx) const;
+    std::vector<std::filesystem::path> paths() const;
+    std::size_t pendingEdits() const { return journalOps; }
+    void insert(const std::size_t idx, const std::filesystem::path &track);
+    void append(const std::filesystem::path &track) { insert(entries.size(), track); }
+    void remove(const std::size_t idx);
+    void move(const std::size_t from, const std::size_t to);
+    void save();
+    Playlist(std::filesystem::path file);
+};
+
+// Playback order over [0, count) with a user queue in front of it.
+// Shuffle is an incremental Fisher-Yates: each step draws from the unplayed tail of `order`, so next() is O(1)
+// and a full pass visits every track exactly once.
+class PlayQueue {
+    std::vector<std::uint32_t> order{};
+    std::size_t cursor{}; // order[0, cursor) has been played this pass.
+    std::deque<std::uint32_t> upNext{};
+    std::mt19937_64 rng{};
+    bool shuffle{};
+
+  public:
+    std::optional<std::size_t> next(const std::size_t current);
+    std::optional<std::size_t> previous(const std::size_t current);
+    void enqueue(const std::size_t idx);
+    void remove(const std::size_t idx);
+    void setShuffle(const bool value);
+    bool isShuffled() const { return shuffle; }
+    std::size_t queued() const { return upNext.size(); }
+    void resize(const std::size_t count);
+    PlayQueue(const std::size_t count, const std::uint64_t seed);
+};
+
+} // namespace trm
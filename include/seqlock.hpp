@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace trm {
+
+// Single-writer, multi-reader sequence lock.
+// The payload is stored as relaxed atomic words so concurrent reads are race-free;
+// readers retry until they observe an unchanged, even sequence number.
+template <typename T> class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock payload must be trivially copyable.");
+    static constexpr std::size_t words{(sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t)};
+    std::atomic<std::uint64_t> sequence{};
+    std::array<std::atomic<std::uint64_t>, words> storage{};
+
+  public:
+    // Must only be called from one thread.
+    void store(const T &value) {
+        std::array<std::uint64_t, words> raw{};
+        std::memcpy(raw.data(), &value, sizeof(T));
+        const std::uint64_t seq{sequence.load(std::memory_order_relaxed)};
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i{}; i < words; ++i) {
+            storage[i].store(raw[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        std::array<std::uint64_t, words> raw{};
+        while (true) {
+            const std::uint64_t before{sequence.load(std::memory_order_acquire)};
+            if (before & 1) [[unlikely]] {
+                std::this_thread::yield();
+                continue;
+            }
+            for (std::size_t i{}; i < words; ++i) {
+                raw[i] = storage[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) [[likely]] {
+                break;
+            }
+        }
+        T value{};
+        std::memcpy(static_cast<void *>(&value), raw.data(), sizeof(T));
+        return value;
+    }
+
+    // Changes on every store. Cheap way for readers to skip unchanged snapshots.
+    std::uint64_t version() const { return sequence.load(std::memory_order_acquire); }
+};
+
+} // namespace trm
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace trm {
+
+// Stress run constants.
+struct StressSpecifiers {
+    static constexpr std::size_t trackSeconds{120};
+    static constexpr std::size_t segmentFrames{480}; // 10 ms per encoded position step.
+    static constexpr std::chrono::milliseconds effectTimeout{2000};
+    static constexpr std::chrono::milliseconds warmup{500};
+    static constexpr std::chrono::milliseconds steady{2000};
+    static constexpr float staleTolerance{0.15f}; // Seek granularity plus one queue's worth of audio, in seconds.
+    static constexpr float minSeekDistance{2.0f};
+    static constexpr std::size_t minTailSamples{1000}; // Below this, p999 is just the maximum and is not reported.
+};
+
+// Stress run configuration.
+struct StressOptions {
+    std::size_t threads{4};
+    std::size_t iterations{200};
+    std::chrono::seconds hammer{5};
+};
+
+// Drives an AudioDevice on miniaudio's null backend against a generated track whose samples encode their own
+// position. Prints command-to-effect latency percentiles and the outcome of each check.
+// Returns true when no check failed.
+bool runStress(const StressOptions &options);
+
+} // namespace trm
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "boundedqueue.hpp"
+
+namespace trm {
+
+// Telemetry constants.
+struct TelemetrySpecifiers {
+    static constexpr std::size_t bufferCapacity{1024};
+    static constexpr std::size_t nameCapacity{64};
+    static constexpr std::chrono::seconds flushInterval{5};
+    static constexpr std::size_t compactThreshold{1 << 16};
+    static constexpr double recencyHalfLifeDays{30.0};
+    static constexpr std::uint32_t logMagic{0x45504D54};       // "TMPE"
+    static constexpr std::uint32_t namesMagic{0x4E504D54};     // "TMPN"
+    static constexpr std::uint32_t aggregateMagic{0x41504D54}; // "TMPA"
+    static constexpr std::uint32_t version{1};
+    static constexpr std::uint32_t maxNameBytes{1 << 16};
+};
+
+// Playback event types.
+enum class PlaybackEventType : std::uint8_t {
+    START,
+    END,
+    SKIP,
+    SEEK,
+    LOOP,
+};
+
+// Fixed-size log record. Stored in native (little-endian) layout.
+struct PlaybackEvent {
+    std::uint64_t time{};  // Unix epoch, milliseconds.
+    std::uint64_t track{}; // fnv1a of the UTF-8 path.
+    float position{};      // Seconds into the track. For SEEK, the position before seeking.
+    float value{};         // Track duration, or the seek target for SEEK.
+    PlaybackEventType type{};
+    std::array<std::uint8_t, 7> reserved{};
+};
+static_assert(sizeof(PlaybackEvent) == 32);
+
+// Per-track aggregate folded from the event log.
+struct TrackStats {
+    std::uint32_t plays{};
+    std::uint32_t completions{};
+    std::uint32_t skips{};
+    std::uint32_t seeks{};
+    float completionSum{};
+    std::uint32_t reserved{}; // Explicit padding: snapshots are written raw and must not carry indeterminate bytes.
+    std::uint64_t lastPlayed{};
+    float completionRatio() const {
+        const std::uint32_t ended{completions + skips};
+        return ended ? completionSum / static_cast<float>(ended) : 0.0f;
+    }
+};
+static_assert(sizeof(TrackStats) == 32);
+
+struct RankedTrack {
+    std::uint64_t track{};
+    double score{};
+};
+
+// Playback history store.
+// emit()/nameTrack() are lock-free and meant for the playback command path. A background thread appends
+// buffered events to a binary log and periodically folds the log into a per-track aggregate snapshot.
+class PlaybackTelemetry {
+    std::filesystem::path directory{};
+    BoundedQueue<PlaybackEvent, TelemetrySpecifiers::bufferCapacity> buffer{};
+    BoundedQueue<std::pair<std::uint64_t, std::string>, TelemetrySpecifiers::nameCapacity> pendingNames{};
+    std::atomic<std::uint64_t> dropped{};
+    std::mutex ioMutex{};
+    std::ofstream eventLog{};
+    std::ofstream nameLog{};
+    std::size_t logEvents{};
+    std::uint64_t epoch{};
+    mutable std::shared_mutex statsMutex{};
+    std::unordered_map<std::uint64_t, TrackStats> aggregates{};
+    std::unordered_map<std::uint64_t, std::string> names{};
+    std::mutex waitMutex{};
+    std::condition_variable condition{};
+    bool terminate{};
+    std::thread flusher{};
+    void flusherThread();
+    void load();
+    void resetLogs();
+    void persist(const std::vector<PlaybackEvent> &events, const std::vector<std::pair<std::uint64_t, std::string>> &n);
+    void apply(const std::vector<PlaybackEvent> &events);
+    void compactLocked();
+
+  public:
+    static std::uint64_t now();
+    void emit(const PlaybackEvent &event);
+    void nameTrack(const std::uint64_t track, std::string u8);
+    void ingest(const std::vector<PlaybackEvent> &events);
+    void flush();
+    void compact();
+    std::optional<TrackStats> query(const std::uint64_t track) const;
+    std::vector<RankedTrack> rank(const std::size_t count, const std::uint64_t at) const;
+    std::string trackName(const std::uint64_t track) const;
+    std::size_t trackCount() const;
+    std::uint64_t droppedEvents() const { return dropped.load(); }
+    PlaybackTelemetry(std::filesystem::path dir);
+    ~PlaybackTelemetry();
+};
+
+// Synthetic listening history for benchmarking: roughly `sessionsPerDay` plays per day over `years`,
+// Zipf-distributed across `tracks`, with seeks, skips and natural ends mixed in.
+std::vector<PlaybackEvent> synthesizeHistory(
+    const std::size_t tracks, const double years, const std::uint64_t endTime, const unsigned int seed,
+    const std::size_t sessionsPerDay = 40
+);
+
+} // namespace trm
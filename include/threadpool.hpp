@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace trm {
+
+// Task signature. Receives the index of the worker executing it.
+using PoolTask = std::function<void(std::size_t)>;
+
+// Per-worker task deque. Owner pops from the back, thieves steal from the front.
+struct WorkerQueue {
+    std::mutex mutex{};
+    std::deque<PoolTask> tasks{};
+};
+
+// Work-stealing thread pool. Tasks must not throw.
+class ThreadPool {
+    std::vector<std::unique_ptr<WorkerQueue>> queues{};
+    std::vector<std::thread> workers{};
+    std::atomic<std::size_t> queued{};
+    std::atomic<std::size_t> pending{};
+    std::atomic<std::size_t> nextQueue{};
+    std::atomic<bool> terminate{};
+    std::mutex idleMutex{};
+    std::condition_variable idleCondition{};
+    std::condition_variable doneCondition{};
+    bool popLocal(const std::size_t idx, PoolTask &task);
+    bool steal(const std::size_t idx, PoolTask &task);
+    void workerThread(const std::size_t idx);
+
+  public:
+    std::size_t size() const { return workers.size(); }
+    void submit(PoolTask task);
+    void wait();
+    ThreadPool(const std::size_t threads);
+    ~ThreadPool();
+};
+
+} // namespace trm
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 
 #define ERR_LIST                                                                                                       \
     E(GENERIC, "A generic exception has been thrown.")                                                                 \
@@ -12,7 +19,14 @@
     E(FFMPEG_OPEN, "File cannot be opened.")                                                                           \
     E(FFMPEG_FILTER, "Filter graph failure.")                                                                          \
     E(FFMPEG_DECODE, "File decode failure.")                                                                           \
-    E(INVALID_COMMAND, "Invalid command.")
+    E(INVALID_COMMAND, "Invalid command.")                                                                             \
+    E(INVALID_ARGUMENT, "Invalid command-line argument.")                                                              \
+    E(FILE_WRITE, "File cannot be written.")                                                                           \
+    E(FILE_READ, "File cannot be read.")                                                                               \
+    E(PLAYLIST_PARSE, "Playlist file is malformed.")                                                                   \
+    E(OUT_OF_RANGE, "Index out of range.")                                                                             \
+    E(PLAYLIST_STALE, "Playlist file was changed outside of the player.")                                              \
+    E(WAV_TOO_LARGE, "Output exceeds the 4 GiB WAV size limit.")
 
 namespace trm {
 
@@ -40,6 +54,66 @@ inline std::string asU8(const std::filesystem::path &path) {
     return std::string{reinterpret_cast<const char *>(u8.data()), u8.length()};
 }
 
+inline bool isAudioFile(const std::filesystem::path &path) {
+    constexpr std::array<const char *, 9> extensions{
+        ".mp3", ".m4a", ".flac", ".wav", ".ogg", ".opus", ".aac", ".wma", ".webm",
+    };
+    std::string ext{asU8(path.extension())};
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+// Stable across runs and platforms, unlike std::hash. Used for on-disk keys.
+constexpr std::uint64_t fnv1a(const std::string_view bytes, std::uint64_t hash = 14695981039346656037ull) {
+    for (const char c : bytes) {
+        hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+inline std::filesystem::path envPath(const char *name) {
+#ifdef _WIN32
+    wchar_t *value{};
+    std::size_t length{};
+    const std::wstring wname{name, name + std::char_traits<char>::length(name)};
+    if (_wdupenv_s(&value, &length, wname.c_str()) != 0 || !value) {
+        return {};
+    }
+    std::filesystem::path out{value};
+    std::free(value);
+    return out;
+#else
+    const char *value{std::getenv(name)};
+    return value ? std::filesystem::path{value} : std::filesystem::path{};
+#endif
+}
+
+// Per-user directory for regenerable data (thumbnails etc.).
+inline std::filesystem::path cacheDirectory() {
+#ifdef _WIN32
+    std::filesystem::path base{envPath("LOCALAPPDATA")};
+#else
+    std::filesystem::path base{envPath("XDG_CACHE_HOME")};
+    if (base.empty() && !envPath("HOME").empty()) {
+        base = envPath("HOME") / ".cache";
+    }
+#endif
+    return (base.empty() ? std::filesystem::temp_directory_path() : base) / "tmplay";
+}
+
+// Per-user directory for persistent application data (playback history etc.).
+inline std::filesystem::path dataDirectory() {
+#ifdef _WIN32
+    std::filesystem::path base{envPath("APPDATA")};
+#else
+    std::filesystem::path base{envPath("XDG_DATA_HOME")};
+    if (base.empty() && !envPath("HOME").empty()) {
+        base = envPath("HOME") / ".local" / "share";
+    }
+#endif
+    return (base.empty() ? std::filesystem::current_path() : base) / "tmplay";
+}
+
 inline void require(const bool cond, const Error err) {
     if (!cond) [[unlikely]] {
         throw std::runtime_error(errMsg[static_cast<std::size_t>(err)]);
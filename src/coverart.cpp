@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <system_error>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavfilter/avfilter.h>
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "coverart.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+using FramePtr = std::unique_ptr<AVFrame, decltype([](AVFrame *f) { av_frame_free(&f); })>;
+using PacketPtr = std::unique_ptr<AVPacket, decltype([](AVPacket *f) { av_packet_free(&f); })>;
+using CodecPtr = std::unique_ptr<AVCodecContext, decltype([](AVCodecContext *f) { avcodec_free_context(&f); })>;
+using FormatPtr = std::unique_ptr<AVFormatContext, decltype([](AVFormatContext *f) { avformat_close_input(&f); })>;
+using GraphPtr = std::unique_ptr<AVFilterGraph, decltype([](AVFilterGraph *f) { avfilter_graph_free(&f); })>;
+
+struct ThumbnailHeader {
+    std::uint32_t magic{CoverArtSpecifiers::cacheMagic};
+    std::uint32_t version{CoverArtSpecifiers::cacheVersion};
+    std::uint16_t width{};
+    std::uint16_t height{};
+};
+
+// Fits the frame inside the thumbnail box and converts it to packed RGB24.
+std::shared_ptr<Thumbnail> downsample(AVFrame *frame) {
+    GraphPtr graph{avfilter_graph_alloc()};
+    require(graph.get(), Error::ALLOC);
+    const AVRational sar{frame->sample_aspect_ratio.num ? frame->sample_aspect_ratio : AVRational{1, 1}};
+    const char *pixFmt{av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format))};
+    require(pixFmt, Error::FFMPEG_FILTER);
+    const std::string inArgs{std::format(
+        "video_size={}x{}:pix_fmt={}:time_base=1/1:pixel_aspect={}/{}", frame->width, frame->height, pixFmt, sar.num,
+        sar.den
+    )};
+    const std::string filterDesc{std::format(
+        "scale=w={}:h={}:force_original_aspect_ratio=decrease:flags=area,format=rgb24", CoverArtSpecifiers::pixelWidth,
+        CoverArtSpecifiers::pixelHeight
+    )};
+    AVFilterContext *inCtx{};
+    AVFilterContext *outCtx{};
+    const AVFilter *buffer{avfilter_get_by_name("buffer")};
+    const AVFilter *bufferSink{avfilter_get_by_name("buffersink")};
+    require(
+        avfilter_graph_create_filter(&inCtx, buffer, "in", inArgs.c_str(), nullptr, graph.get()) >= 0,
+        Error::FFMPEG_FILTER
+    );
+    require(
+        avfilter_graph_create_filter(&outCtx, bufferSink, "out", nullptr, nullptr, graph.get()) >= 0,
+        Error::FFMPEG_FILTER
+    );
+    AVFilterInOut *in{avfilter_inout_alloc()};
+    AVFilterInOut *out{avfilter_inout_alloc()};
+    try {
+        require(in && out, Error::ALLOC);
+        in->name = av_strdup("out");
+        in->filter_ctx = outCtx;
+        in->pad_idx = 0;
+        in->next = nullptr;
+        out->name = av_strdup("in");
+        out->filter_ctx = inCtx;
+        out->pad_idx = 0;
+        out->next = nullptr;
+        require(
+            avfilter_graph_parse_ptr(graph.get(), filterDesc.c_str(), &in, &out, nullptr) >= 0, Error::FFMPEG_FILTER
+        );
+        avfilter_inout_free(&in);
+        avfilter_inout_free(&out);
+    } catch (...) {
+        avfilter_inout_free(&in);
+        avfilter_inout_free(&out);
+        throw;
+    }
+    require(avfilter_graph_config(graph.get(), nullptr) >= 0, Error::FFMPEG_FILTER);
+    require(av_buffersrc_add_frame(inCtx, frame) >= 0, Error::FFMPEG_FILTER);
+    require(av_buffersrc_add_frame(inCtx, nullptr) >= 0, Error::FFMPEG_FILTER);
+    FramePtr scaled{av_frame_alloc()};
+    require(scaled.get(), Error::ALLOC);
+    require(av_buffersink_get_frame(outCtx, scaled.get()) >= 0, Error::FFMPEG_FILTER);
+
+    auto thumb{std::make_shared<Thumbnail>()};
+    thumb->width = scaled->width;
+    thumb->height = scaled->height;
+    thumb->rgb.resize(static_cast<std::size_t>(thumb->width * thumb->height * 3));
+    for (int y{}; y < thumb->height; ++y) {
+        const std::uint8_t *row{scaled->data[0] + static_cast<std::ptrdiff_t>(y) * scaled->linesize[0]};
+        std::copy(row, row + thumb->width * 3, thumb->rgb.begin() + y * thumb->width * 3);
+    }
+    return thumb;
+}
+
+// Decodes the attached picture of an audio file, or the first frame of an image file.
+// Returns null if there is no picture.
+std::shared_ptr<Thumbnail> extractImage(const std::filesystem::path &file) {
+    AVFormatContext *fctx{};
+    if (avformat_open_input(&fctx, asU8(file).data(), nullptr, nullptr) < 0) {
+        return nullptr;
+    }
+    FormatPtr format{fctx};
+    PacketPtr packet{av_packet_alloc()};
+    require(packet.get(), Error::ALLOC);
+
+    int streamIdx{-1};
+    for (unsigned int i{}; i < format->nb_streams; ++i) {
+        if (format->streams[i]->disposition & AV_DISPOSITION_ATTACHED_PIC) {
+            streamIdx = static_cast<int>(i);
+            break;
+        }
+    }
+    if (streamIdx >= 0) {
+        require(av_packet_ref(packet.get(), &format->streams[streamIdx]->attached_pic) >= 0, Error::FFMPEG_DECODE);
+    } else {
+        // Audio without an attached picture. Standalone images demux as a one-frame video stream.
+        if (isAudioFile(file)) {
+            return nullptr;
+        }
+        require(avformat_find_stream_info(format.get(), nullptr) >= 0, Error::FFMPEG_OPEN);
+        streamIdx = av_find_best_stream(format.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (streamIdx < 0) {
+            return nullptr;
+        }
+        do {
+            av_packet_unref(packet.get());
+            require(av_read_frame(format.get(), packet.get()) >= 0, Error::FFMPEG_DECODE);
+        } while (packet->stream_index != streamIdx);
+    }
+
+    const AVCodecParameters *params{format->streams[streamIdx]->codecpar};
+    const AVCodec *codec{avcodec_find_decoder(params->codec_id)};
+    require(codec, Error::FFMPEG_OPEN);
+    CodecPtr codecCtx{avcodec_alloc_context3(codec)};
+    require(codecCtx.get(), Error::ALLOC);
+    require(avcodec_parameters_to_context(codecCtx.get(), params) >= 0, Error::FFMPEG_OPEN);
+    require(avcodec_open2(codecCtx.get(), codec, nullptr) >= 0, Error::FFMPEG_OPEN);
+    require(avcodec_send_packet(codecCtx.get(), packet.get()) >= 0, Error::FFMPEG_DECODE);
+    require(avcodec_send_packet(codecCtx.get(), nullptr) >= 0, Error::FFMPEG_DECODE);
+    FramePtr frame{av_frame_alloc()};
+    require(frame.get(), Error::ALLOC);
+    require(avcodec_receive_frame(codecCtx.get(), frame.get()) >= 0, Error::FFMPEG_DECODE);
+    return downsample(frame.get());
+}
+
+// nullopt: not cached. Null pointer: cached as having no art.
+std::optional<std::shared_ptr<const Thumbnail>> readThumbnail(const std::filesystem::path &file) {
+    std::ifstream in{file, std::ios::binary};
+    ThumbnailHeader header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != CoverArtSpecifiers::cacheMagic ||
+        header.version != CoverArtSpecifiers::cacheVersion || header.width > CoverArtSpecifiers::pixelWidth ||
+        header.height > CoverArtSpecifiers::pixelHeight) {
+        return std::nullopt;
+    }
+    if (!header.width || !header.height) {
+        return std::shared_ptr<const Thumbnail>{};
+    }
+    auto thumb{std::make_shared<Thumbnail>()};
+    thumb->width = header.width;
+    thumb->height = header.height;
+    thumb->rgb.resize(static_cast<std::size_t>(thumb->width * thumb->height * 3));
+    if (!in.read(reinterpret_cast<char *>(thumb->rgb.data()), static_cast<std::streamsize>(thumb->rgb.size()))) {
+        return std::nullopt;
+    }
+    return thumb;
+}
+
+// Best effort. A failed write only costs a re-extraction next run.
+void writeThumbnail(const std::filesystem::path &file, const Thumbnail *thumb) {
+    std::ofstream out{file, std::ios::binary | std::ios::trunc};
+    ThumbnailHeader header{};
+    if (thumb) {
+        header.width = static_cast<std::uint16_t>(thumb->width);
+        header.height = static_cast<std::uint16_t>(thumb->height);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (thumb) {
+        out.write(reinterpret_cast<const char *>(thumb->rgb.data()), static_cast<std::streamsize>(thumb->rgb.size()));
+    }
+}
+
+} // namespace
+
+CoverArtCache::CoverArtCache(std::function<void()> ready) : onReady{std::move(ready)} {
+    std::error_code ec{};
+    cacheDir = cacheDirectory() / "thumbnails";
+    std::filesystem::create_directories(cacheDir, ec);
+    worker = std::thread([this] { this->workerThread(); });
+}
+
+CoverArtCache::~CoverArtCache() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        terminate = true;
+    }
+    condition.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+// Returns the cached thumbnail, or null while it is loading or if the track has none.
+// A miss schedules the track ahead of any prefetches.
+std::shared_ptr<const Thumbnail> CoverArtCache::get(const std::filesystem::path &track) {
+    const std::string key{asU8(track)};
+    std::lock_guard<std::mutex> lock{mutex};
+    if (const auto it{entries.find(key)}; it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return it->second.thumb;
+    }
+    if (queued.insert(key).second) {
+        urgent.push_back(track);
+        condition.notify_one();
+    } else if (const auto it{std::find(prefetched.begin(), prefetched.end(), track)}; it != prefetched.end()) {
+        urgent.push_back(std::move(*it));
+        prefetched.erase(it);
+    } else if (key == inFlight) {
+        // Already being produced as a prefetch; make sure the finished result still triggers a redraw.
+        inFlightWanted = true;
+    }
+    return nullptr;
+}
+
+// Replaces the pending prefetch set, so scrolling never builds up a backlog.
+void CoverArtCache::prefetch(const std::vector<std::filesystem::path> &tracks) {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (const std::filesystem::path &track : prefetched) {
+        queued.erase(asU8(track));
+    }
+    prefetched.clear();
+    for (const std::filesystem::path &track : tracks) {
+        const std::string key{asU8(track)};
+        if (!entries.contains(key) && queued.insert(key).second) {
+            prefetched.push_back(track);
+        }
+    }
+    condition.notify_one();
+}
+
+// The key covers the track and every folder image next to it, so adding or replacing a cover.jpg invalidates it.
+std::filesystem::path CoverArtCache::diskPath(const std::filesystem::path &track) const {
+    const auto stamp{[](const std::filesystem::path &file) {
+        std::error_code ec{};
+        const std::uintmax_t size{std::filesystem::file_size(file, ec)};
+        if (ec) {
+            return std::string{};
+        }
+        return std::format("|{}|{}", size, std::filesystem::last_write_time(file, ec).time_since_epoch().count());
+    }};
+    std::string identity{asU8(track) + stamp(track)};
+    for (const char *image : CoverArtSpecifiers::folderImages) {
+        if (const std::string fallback{stamp(track.parent_path() / image)}; !fallback.empty()) {
+            identity += std::format("|{}{}", image, fallback);
+        }
+    }
+    return cacheDir / std::format("{:016x}.thumb", fnv1a(identity));
+}
+
+// Only a clean "no art anywhere" is persisted as a negative entry. Errors may be transient (a file still being
+// copied, a locked file), so their result is kept in memory for this session only.
+std::shared_ptr<const Thumbnail> CoverArtCache::produce(const std::filesystem::path &track) {
+    const std::filesystem::path disk{diskPath(track)};
+    if (std::optional<std::shared_ptr<const Thumbnail>> cached{readThumbnail(disk)}) {
+        return *cached;
+    }
+    std::shared_ptr<const Thumbnail> thumb{};
+    bool failed{};
+    try {
+        thumb = extractImage(track);
+        for (std::size_t i{}; !thumb && i < CoverArtSpecifiers::folderImages.size(); ++i) {
+            const std::filesystem::path candidate{track.parent_path() / CoverArtSpecifiers::folderImages[i]};
+            std::error_code ec{};
+            if (std::filesystem::is_regular_file(candidate, ec)) {
+                thumb = extractImage(candidate);
+            }
+        }
+    } catch (const std::exception &) {
+        thumb = nullptr;
+        failed = true;
+    }
+    if (!failed) {
+        writeThumbnail(disk, thumb.get());
+    }
+    return thumb;
+}
+
+// Not thread-safe. Must be used within the mutex.
+void CoverArtCache::insert(const std::string &key, std::shared_ptr<const Thumbnail> thumb) {
+    const std::size_t bytes{CoverArtSpecifiers::entryOverhead + (thumb ? thumb->rgb.size() : 0)};
+    lru.push_front(key);
+    entries[key] = Entry{.thumb = std::move(thumb), .lru = lru.begin(), .bytes = bytes};
+    usedBytes += bytes;
+    while (usedBytes > CoverArtSpecifiers::memoryBudget && lru.size() > 1) {
+        const auto victim{entries.find(lru.back())};
+        usedBytes -= victim->second.bytes;
+        entries.erase(victim);
+        lru.pop_back();
+    }
+}
+
+void CoverArtCache::workerThread() {
+    std::unique_lock<std::mutex> lock{mutex};
+    while (true) {
+        condition.wait(lock, [this] { return this->terminate || !this->urgent.empty() || !this->prefetched.empty(); });
+        if (terminate) {
+            return;
+        }
+        const bool isUrgent{!urgent.empty()};
+        std::deque<std::filesystem::path> &source{isUrgent ? urgent : prefetched};
+        const std::filesystem::path track{std::move(source.front())};
+        source.pop_front();
+        const std::string key{asU8(track)};
+        inFlight = key;
+        lock.unlock();
+        std::shared_ptr<const Thumbnail> thumb{produce(track)};
+        lock.lock();
+        queued.erase(key);
+        insert(key, std::move(thumb));
+        const bool wanted{isUrgent || inFlightWanted};
+        inFlight.clear();
+        inFlightWanted = false;
+        if (wanted && onReady) {
+            lock.unlock();
+            onReady();
+            lock.lock();
+        }
+    }
+}
+
+} // namespace trm
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <format>
 #include <optional>
@@ -143,6 +145,37 @@ std::optional<std::int16_t> Decoder::acquireSample() {
     return std::nullopt;
 }
 
+// Bulk variant of getSample(). Returns the number of samples written, short only on EOF.
+std::size_t Decoder::getSamples(std::int16_t *out, const std::size_t count) {
+    constexpr float denum{MaDeviceSpecifiers::channels * MaDeviceSpecifiers::sampleRate};
+    const AVRational timeBase{av_buffersink_get_time_base(state.filterOutCtx)};
+    std::size_t served{};
+    while (served != count && !state.eof) {
+        const int available{
+            static_cast<int>(state.filterFrame->nb_samples * MaDeviceSpecifiers::channels) - state.cSample
+        };
+        if (available > 0) [[likely]] {
+            const std::size_t n{std::min(count - served, static_cast<std::size_t>(available))};
+            std::memcpy(
+                out + served, reinterpret_cast<std::int16_t *>(state.filterFrame->data[0]) + state.cSample,
+                n * sizeof(std::int16_t)
+            );
+            state.cSample += static_cast<int>(n);
+            served += n;
+            data.timestamp = fromStreamTicks(state.filterFrame->pts, timeBase) + state.cSample / denum;
+            continue;
+        }
+        const DecodeStatus fAcq{acquireFFrame()};
+        if (fAcq == DecodeStatus::AV_EOF) [[unlikely]] {
+            state.eof = true;
+            break;
+        }
+        require(fAcq != DecodeStatus::AV_EXCEPTION, Error::FFMPEG_DECODE);
+        state.cSample = 0;
+    }
+    return served;
+}
+
 DecodeStatus Decoder::retrFFrame() noexcept {
     av_frame_unref(state.filterFrame.get());
     const int out{av_buffersink_get_frame(state.filterOutCtx, state.filterFrame.get())};
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TRM_EQ_SSE
+#include <pmmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+#include "equalizer.hpp"
+#include "maudio.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+constexpr float convergence{1e-6f};
+constexpr float s16Scale{32768.0f};
+constexpr float denormalFloor{1e-20f};
+
+bool isIdentity(const BiquadCoeffs &c) {
+    return c.b0 == 1.0f && c.b1 == 0.0f && c.b2 == 0.0f && c.a1 == 0.0f && c.a2 == 0.0f;
+}
+
+float approach(float &cur, const float tgt) {
+    const float delta{tgt - cur};
+    cur += delta * EqSpecifiers::smoothing;
+    return std::abs(delta);
+}
+
+} // namespace
+
+BiquadCoeffs Equalizer::design(const EqBand &band, const float sampleRate) {
+    if (!band.enabled) {
+        return BiquadCoeffs{};
+    }
+    const double freq{std::clamp(band.frequency, EqSpecifiers::minFrequency, sampleRate * 0.45f)};
+    const double q{std::clamp(band.q, EqSpecifiers::minQ, EqSpecifiers::maxQ)};
+    const double a{std::pow(10.0, band.gain / 40.0)};
+    const double w0{2.0 * std::numbers::pi * freq / sampleRate};
+    const double cosW{std::cos(w0)};
+    const double alpha{std::sin(w0) / (2.0 * q)};
+    const double sqrtA2Alpha{2.0 * std::sqrt(a) * alpha};
+    double b0{}, b1{}, b2{}, a0{}, a1{}, a2{};
+    switch (band.type) {
+    case FilterType::PEAK:
+        b0 = 1.0 + alpha * a;
+        b1 = -2.0 * cosW;
+        b2 = 1.0 - alpha * a;
+        a0 = 1.0 + alpha / a;
+        a1 = -2.0 * cosW;
+        a2 = 1.0 - alpha / a;
+        break;
+    case FilterType::LOW_SHELF:
+        b0 = a * ((a + 1.0) - (a - 1.0) * cosW + sqrtA2Alpha);
+        b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosW);
+        b2 = a * ((a + 1.0) - (a - 1.0) * cosW - sqrtA2Alpha);
+        a0 = (a + 1.0) + (a - 1.0) * cosW + sqrtA2Alpha;
+        a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosW);
+        a2 = (a + 1.0) + (a - 1.0) * cosW - sqrtA2Alpha;
+        break;
+    case FilterType::HIGH_SHELF:
+        b0 = a * ((a + 1.0) + (a - 1.0) * cosW + sqrtA2Alpha);
+        b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW);
+        b2 = a * ((a + 1.0) + (a - 1.0) * cosW - sqrtA2Alpha);
+        a0 = (a + 1.0) - (a - 1.0) * cosW + sqrtA2Alpha;
+        a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW);
+        a2 = (a + 1.0) - (a - 1.0) * cosW - sqrtA2Alpha;
+        break;
+    case FilterType::LOW_PASS:
+        b0 = (1.0 - cosW) / 2.0;
+        b1 = 1.0 - cosW;
+        b2 = (1.0 - cosW) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW;
+        a2 = 1.0 - alpha;
+        break;
+    case FilterType::HIGH_PASS:
+        b0 = (1.0 + cosW) / 2.0;
+        b1 = -(1.0 + cosW);
+        b2 = (1.0 + cosW) / 2.0;
+        a0 = 1.0 + alpha;
+        a1 = -2.0 * cosW;
+        a2 = 1.0 - alpha;
+        break;
+    }
+    return BiquadCoeffs{
+        .b0 = static_cast<float>(b0 / a0),
+        .b1 = static_cast<float>(b1 / a0),
+        .b2 = static_cast<float>(b2 / a0),
+        .a1 = static_cast<float>(a1 / a0),
+        .a2 = static_cast<float>(a2 / a0),
+    };
+}
+
+// Fields are published individually; a reader racing a write may see a mix of old and new
+// parameters for one block, which the generation bump corrects on the next.
+void Equalizer::setBand(const std::size_t idx, const EqBand &band) {
+    require(idx < EqSpecifiers::maxBands, Error::INVALID_COMMAND);
+    EqBandSlot &slot{slots[idx]};
+    slot.type.store(band.type, std::memory_order_relaxed);
+    slot.frequency.store(band.frequency, std::memory_order_relaxed);
+    slot.gain.store(band.gain, std::memory_order_relaxed);
+    slot.q.store(band.q, std::memory_order_relaxed);
+    slot.enabled.store(band.enabled, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+EqBand Equalizer::getBand(const std::size_t idx) const {
+    require(idx < EqSpecifiers::maxBands, Error::INVALID_COMMAND);
+    const EqBandSlot &slot{slots[idx]};
+    return EqBand{
+        .type = slot.type.load(std::memory_order_relaxed),
+        .frequency = slot.frequency.load(std::memory_order_relaxed),
+        .gain = slot.gain.load(std::memory_order_relaxed),
+        .q = slot.q.load(std::memory_order_relaxed),
+        .enabled = slot.enabled.load(std::memory_order_relaxed),
+    };
+}
+
+void Equalizer::setEnabled(const bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+// Clears filter memory. Used on discontinuities (seek, new track); coefficients are kept.
+void Equalizer::reset() { memory.fill(BiquadState{}); }
+
+void Equalizer::refreshTargets() {
+    const std::uint32_t gen{generation.load(std::memory_order_acquire)};
+    if (gen == seenGeneration) [[likely]] {
+        return;
+    }
+    seenGeneration = gen;
+    const bool on{enabled.load(std::memory_order_relaxed)};
+    for (std::size_t i{}; i < EqSpecifiers::maxBands; ++i) {
+        const EqBand band{getBand(i)};
+        target[i] = on ? design(band, MaDeviceSpecifiers::sampleRate) : BiquadCoeffs{};
+        live[i] = live[i] || !isIdentity(target[i]);
+    }
+}
+
+void Equalizer::smoothCoefficients() {
+    for (std::size_t i{}; i < EqSpecifiers::maxBands; ++i) {
+        if (!live[i]) {
+            continue;
+        }
+        BiquadCoeffs &cur{current[i]};
+        const BiquadCoeffs &tgt{target[i]};
+        float delta{};
+        delta = std::max(delta, approach(cur.b0, tgt.b0));
+        delta = std::max(delta, approach(cur.b1, tgt.b1));
+        delta = std::max(delta, approach(cur.b2, tgt.b2));
+        delta = std::max(delta, approach(cur.a1, tgt.a1));
+        delta = std::max(delta, approach(cur.a2, tgt.a2));
+        if (delta < convergence) {
+            cur = tgt;
+            // A band that has faded back to unity is dropped from the chain entirely.
+            if (isIdentity(cur)) {
+                live[i] = false;
+                memory[i] = BiquadState{};
+            }
+        }
+    }
+}
+
+void Equalizer::processBlock(float *samples, const std::size_t frames) {
+    for (std::size_t i{}; i < EqSpecifiers::maxBands; ++i) {
+        if (!live[i]) {
+            continue;
+        }
+        const BiquadCoeffs &c{current[i]};
+        BiquadState &m{memory[i]};
+#ifdef TRM_EQ_SSE
+        const __m128 b0{_mm_set1_ps(c.b0)};
+        const __m128 b1{_mm_set1_ps(c.b1)};
+        const __m128 b2{_mm_set1_ps(c.b2)};
+        const __m128 a1{_mm_set1_ps(c.a1)};
+        const __m128 a2{_mm_set1_ps(c.a2)};
+        __m128 z1{_mm_load_ps(m.z1.data())};
+        __m128 z2{_mm_load_ps(m.z2.data())};
+        for (std::size_t f{}; f < frames; ++f) {
+            float *frame{samples + f * MaDeviceSpecifiers::channels};
+            const __m128 x{_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64 *>(frame))};
+            const __m128 y{_mm_add_ps(_mm_mul_ps(b0, x), z1)};
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_storel_pi(reinterpret_cast<__m64 *>(frame), y);
+        }
+        _mm_store_ps(m.z1.data(), z1);
+        _mm_store_ps(m.z2.data(), z2);
+#else
+        for (std::size_t f{}; f < frames; ++f) {
+            float *frame{samples + f * MaDeviceSpecifiers::channels};
+            for (std::size_t ch{}; ch < MaDeviceSpecifiers::channels; ++ch) {
+                const float x{frame[ch]};
+                const float y{c.b0 * x + m.z1[ch]};
+                m.z1[ch] = c.b1 * x - c.a1 * y + m.z2[ch];
+                m.z2[ch] = c.b2 * x - c.a2 * y;
+                frame[ch] = y;
+            }
+        }
+        // No FTZ here: a decayed tail is cut off per block so silence never runs on subnormal state.
+        for (std::size_t ch{}; ch < MaDeviceSpecifiers::channels; ++ch) {
+            m.z1[ch] = std::abs(m.z1[ch]) < denormalFloor ? 0.0f : m.z1[ch];
+            m.z2[ch] = std::abs(m.z2[ch]) < denormalFloor ? 0.0f : m.z2[ch];
+        }
+#endif
+    }
+}
+
+// Filters interleaved stereo samples in place. count is in samples, not frames.
+void Equalizer::process(std::int16_t *samples, const std::size_t count) {
+    refreshTargets();
+    if (std::none_of(live.begin(), live.end(), [](bool l) { return l; })) [[likely]] {
+        return;
+    }
+#ifdef TRM_EQ_SSE
+    // Decaying tails after silence or a pause would otherwise sink into subnormals, which are far slower to compute.
+    // The caller's mode is restored afterwards.
+    const unsigned int csr{_mm_getcsr()};
+    _mm_setcsr(csr | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
+#endif
+    alignas(16) std::array<float, EqSpecifiers::blockFrames * MaDeviceSpecifiers::channels> block{};
+    for (std::size_t offset{}; offset < count; offset += block.size()) {
+        const std::size_t n{std::min(block.size(), count - offset)};
+        std::int16_t *chunk{samples + offset};
+        for (std::size_t i{}; i < n; ++i) {
+            block[i] = chunk[i] / s16Scale;
+        }
+        smoothCoefficients();
+        processBlock(block.data(), n / MaDeviceSpecifiers::channels);
+        for (std::size_t i{}; i < n; ++i) {
+            const float scaled{std::clamp(block[i] * s16Scale, -s16Scale, s16Scale - 1.0f)};
+            chunk[i] = static_cast<std::int16_t>(std::lrint(scaled));
+        }
+    }
+#ifdef TRM_EQ_SSE
+    _mm_setcsr(csr);
+#endif
+}
+
+} // namespace trm
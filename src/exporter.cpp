@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "decoder.hpp"
+#include "exporter.hpp"
+#include "maudio.hpp"
+#include "threadpool.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+// The header is padded with a JUNK chunk to one full block so PCM data, and every buffer flush after it,
+// starts on a block boundary in the file.
+constexpr std::size_t wavHeaderSize{ExportOptions::writeAlignment};
+constexpr std::size_t junkSize{wavHeaderSize - 12 - 24 - 8 - 8};
+// The RIFF size field counts everything after itself in 32 bits.
+constexpr std::uint64_t maxDataBytes{UINT32_MAX - (wavHeaderSize - 8)};
+
+std::FILE *openForWrite(const std::filesystem::path &path) {
+#ifdef _WIN32
+    std::FILE *file{};
+    return _wfopen_s(&file, path.c_str(), L"wb") == 0 ? file : nullptr;
+#else
+    return std::fopen(path.c_str(), "wb");
+#endif
+}
+
+template <typename T> void putLE(std::byte *&out, const T value) {
+    for (std::size_t i{}; i < sizeof(T); ++i) {
+        *out++ = static_cast<std::byte>((static_cast<std::uint64_t>(value) >> (i * 8)) & 0xFF);
+    }
+}
+
+} // namespace
+
+AlignedBuffer::AlignedBuffer(const std::size_t bytes) {
+    constexpr std::size_t align{ExportOptions::writeAlignment};
+    size = std::max(ExportOptions::minBufferSize, bytes / align * align);
+    data.reset(static_cast<std::byte *>(::operator new[](size, std::align_val_t{align})));
+}
+
+// Output goes to a ".part" file that only takes the real name in finish(), so a failed export leaves nothing behind.
+WavWriter::WavWriter(const std::filesystem::path &path, AlignedBuffer &buf)
+    : target{path}, partial{std::filesystem::path{path} += ".part"}, buffer{buf} {
+    file.reset(openForWrite(partial));
+    require(file.get(), Error::FILE_WRITE);
+    // Writes are already block-sized; stdio buffering would only add a copy.
+    std::setvbuf(file.get(), nullptr, _IONBF, 0);
+    writeHeader();
+}
+
+void WavWriter::writeHeader() {
+    constexpr std::uint16_t bitsPerSample{16};
+    constexpr std::uint16_t blockAlign{MaDeviceSpecifiers::channels * bitsPerSample / 8};
+    const std::uint32_t dataSize{static_cast<std::uint32_t>(dataBytes)};
+    std::array<std::byte, wavHeaderSize> header{};
+    std::byte *out{header.data()};
+    std::memcpy(out, "RIFF", 4);
+    out += 4;
+    putLE<std::uint32_t>(out, static_cast<std::uint32_t>(wavHeaderSize - 8) + dataSize);
+    std::memcpy(out, "WAVEfmt ", 8);
+    out += 8;
+    putLE<std::uint32_t>(out, 16);
+    putLE<std::uint16_t>(out, 1);
+    putLE<std::uint16_t>(out, MaDeviceSpecifiers::channels);
+    putLE<std::uint32_t>(out, MaDeviceSpecifiers::sampleRate);
+    putLE<std::uint32_t>(out, MaDeviceSpecifiers::sampleRate * blockAlign);
+    putLE<std::uint16_t>(out, blockAlign);
+    putLE<std::uint16_t>(out, bitsPerSample);
+    std::memcpy(out, "JUNK", 4);
+    out += 4;
+    putLE<std::uint32_t>(out, junkSize);
+    out += junkSize;
+    std::memcpy(out, "data", 4);
+    out += 4;
+    putLE<std::uint32_t>(out, dataSize);
+    require(std::fseek(file.get(), 0, SEEK_SET) == 0, Error::FILE_WRITE);
+    require(std::fwrite(header.data(), 1, header.size(), file.get()) == header.size(), Error::FILE_WRITE);
+}
+
+void WavWriter::flush() {
+    if (!used) {
+        return;
+    }
+    require(std::fwrite(buffer.data.get(), 1, used, file.get()) == used, Error::FILE_WRITE);
+    used = 0;
+}
+
+void WavWriter::commit(const std::size_t samples) {
+    const std::size_t bytes{samples * sizeof(std::int16_t)};
+    require(dataBytes + bytes <= maxDataBytes, Error::WAV_TOO_LARGE);
+    used += bytes;
+    dataBytes += bytes;
+    if (used == buffer.size) {
+        flush();
+    }
+}
+
+// Flushes the tail and patches the header sizes. Returns total bytes written.
+std::uint64_t WavWriter::finish() {
+    flush();
+    writeHeader();
+    require(std::fflush(file.get()) == 0, Error::FILE_WRITE);
+    file.reset();
+    std::error_code ec{};
+    std::filesystem::rename(partial, target, ec);
+    if (ec) [[unlikely]] {
+        std::filesystem::remove(partial, ec);
+        require(false, Error::FILE_WRITE);
+    }
+    return dataBytes + wavHeaderSize;
+}
+
+WavWriter::~WavWriter() {
+    if (file) {
+        file.reset();
+        std::error_code ec{};
+        std::filesystem::remove(partial, ec);
+    }
+}
+
+BatchExporter::BatchExporter(ExportOptions opts) : options{std::move(opts)} {
+    require(!options.inputs.empty(), Error::INVALID_ARGUMENT);
+    if (!options.threads) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    options.threads = std::min(options.threads, options.inputs.size());
+    std::filesystem::create_directories(options.outputDir);
+}
+
+// Maps inputs to unique output names, suffixing stems that collide.
+std::vector<std::filesystem::path> BatchExporter::outputPaths() const {
+    std::vector<std::filesystem::path> outputs{};
+    std::set<std::filesystem::path> taken{};
+    outputs.reserve(options.inputs.size());
+    for (const std::filesystem::path &input : options.inputs) {
+        std::filesystem::path out{options.outputDir / input.stem()};
+        out += ".wav";
+        for (std::size_t n{1}; taken.contains(out); ++n) {
+            out = options.outputDir / input.stem();
+            out += std::format("-{}.wav", n);
+        }
+        taken.insert(out);
+        outputs.push_back(out);
+    }
+    return outputs;
+}
+
+ExportStats BatchExporter::run() {
+    const std::vector<std::filesystem::path> outputs{outputPaths()};
+    std::vector<AlignedBuffer> buffers{};
+    buffers.reserve(options.threads);
+    for (std::size_t i{}; i < options.threads; ++i) {
+        buffers.emplace_back(options.memoryBudget / options.threads);
+    }
+
+    std::atomic<std::size_t> failed{};
+    std::atomic<std::uint64_t> bytesWritten{};
+    std::atomic<std::uint64_t> samplesDecoded{};
+    std::mutex logMutex{};
+    const auto begin{std::chrono::steady_clock::now()};
+    {
+        ThreadPool pool{options.threads};
+        for (std::size_t i{}; i < options.inputs.size(); ++i) {
+            pool.submit([&, i](const std::size_t worker) {
+                try {
+                    Decoder decoder{options.inputs[i]};
+                    WavWriter writer{outputs[i], buffers[worker]};
+                    std::uint64_t samples{};
+                    while (!decoder.eof()) {
+                        const std::size_t got{decoder.getSamples(writer.writePtr(), writer.writeCapacity())};
+                        writer.commit(got);
+                        samples += got;
+                    }
+                    bytesWritten += writer.finish();
+                    samplesDecoded += samples;
+                } catch (const std::exception &e) {
+                    ++failed;
+                    std::lock_guard<std::mutex> lock{logMutex};
+                    std::cerr << std::format("{}: {}\n", asU8(options.inputs[i]), e.what());
+                }
+            });
+        }
+        pool.wait();
+    }
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - begin};
+
+    constexpr double samplesPerSecond{MaDeviceSpecifiers::channels * MaDeviceSpecifiers::sampleRate};
+    return ExportStats{
+        .files = options.inputs.size(),
+        .failed = failed.load(),
+        .bytesWritten = bytesWritten.load(),
+        .audioSeconds = samplesDecoded.load() / samplesPerSecond,
+        .wallSeconds = elapsed.count(),
+    };
+}
+
+} // namespace trm
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <random>
+#include <string>
+#include <system_error>
+
+#include <ftxui/screen/terminal.hpp>
+
+#include "interface.hpp"
+#include "maudio.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+std::string formatTime(const float seconds) {
+    const int total{static_cast<int>(std::max(0.0f, seconds))};
+    return std::format("{:02}:{:02}", total / 60, total % 60);
+}
+
+} // namespace
+
+Interface::Interface(AudioDevice &dev, const std::vector<std::filesystem::path> &paths)
+    : device{dev}, queue{0, std::random_device{}()}, screen{ftxui::ScreenInteractive::Fullscreen()},
+      art{[this] { this->screen.PostEvent(ftxui::Event::Custom); }} {
+    for (const std::filesystem::path &path : paths) {
+        std::error_code ec{};
+        if (std::filesystem::is_directory(path, ec)) {
+            for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(
+                     path, std::filesystem::directory_options::skip_permission_denied, ec
+                 )) {
+                if (entry.is_regular_file(ec) && isAudioFile(entry.path())) {
+                    library.push_back(entry.path());
+                }
+            }
+        } else if (std::filesystem::is_regular_file(path, ec) && path.extension() == ".json") {
+            // Edits go through the playlist's journal, so only one can be open at a time.
+            if (playlist) {
+                notice = std::format("only one playlist can be open, ignored {}", asU8(path.filename()));
+                continue;
+            }
+            playlist.emplace(path);
+        } else if (std::filesystem::is_regular_file(path, ec)) {
+            library.push_back(path);
+        }
+    }
+    queue.resize(trackCount());
+    device.setVol(1.0f);
+    device.play();
+    prefetchVisible();
+}
+
+Interface::~Interface() { stopRefresh(); }
+
+void Interface::run() {
+    ftxui::Component root{ftxui::CatchEvent(
+        ftxui::Renderer([this] { return this->render(); }),
+        [this](const ftxui::Event &event) { return this->onEvent(event); }
+    )};
+    refreshThread = std::thread([this] { this->refreshLoop(); });
+    screen.Loop(root);
+    stopRefresh();
+}
+
+void Interface::stopRefresh() {
+    {
+        std::lock_guard<std::mutex> lock{refreshMutex};
+        terminate = true;
+    }
+    refreshCondition.notify_one();
+    if (refreshThread.joinable()) {
+        refreshThread.join();
+    }
+}
+
+// Wakes the UI loop only when the published snapshot has moved on. Polling backs off
+// geometrically while nothing changes, so a paused or idle player costs almost nothing.
+void Interface::refreshLoop() {
+    std::uint64_t version{device.getSnapshotVersion()};
+    std::chrono::milliseconds interval{InterfaceSpecifiers::activeFrame};
+    std::unique_lock<std::mutex> lock{refreshMutex};
+    while (!terminate) {
+        refreshCondition.wait_for(lock, interval, [this] { return this->terminate; });
+        const std::uint64_t current{device.getSnapshotVersion()};
+        if (current != version) {
+            version = current;
+            interval = InterfaceSpecifiers::activeFrame;
+            screen.PostEvent(ftxui::Event::Custom);
+        } else {
+            interval = std::min(interval * 2, InterfaceSpecifiers::idleFrame);
+        }
+    }
+}
+
+std::size_t Interface::trackCount() const { return library.size() + (playlist ? playlist->size() : 0); }
+
+// Playlist entries are only expanded to paths for the rows that are drawn or played.
+std::filesystem::path Interface::trackAt(const std::size_t idx) const {
+    return idx < library.size() ? library[idx] : playlist->at(idx - library.size());
+}
+
+void Interface::playIndex(const std::size_t idx) {
+    if (idx >= trackCount()) {
+        return;
+    }
+    const std::filesystem::path track{trackAt(idx)};
+    playing = idx;
+    device.start(track);
+    device.play();
+    art.get(track);
+}
+
+void Interface::playNext() {
+    if (const std::optional<std::size_t> next{queue.next(playing)}) {
+        playIndex(*next);
+    }
+}
+
+// Warms cover art for the rows around the cursor. The list can show at most a screenful on either side.
+void Interface::prefetchVisible() {
+    const std::size_t span{visibleRows()};
+    const std::size_t first{selected > span ? selected - span : 0};
+    const std::size_t last{std::min(trackCount(), selected + span)};
+    std::vector<std::filesystem::path> tracks{};
+    tracks.reserve(last > first ? last - first : 0);
+    for (std::size_t i{first}; i < last; ++i) {
+        tracks.push_back(trackAt(i));
+    }
+    if (!tracks.empty()) {
+        art.prefetch(tracks);
+    }
+}
+
+// Library rows that fit inside the border.
+std::size_t Interface::visibleRows() const {
+    return static_cast<std::size_t>(std::max(1, ftxui::Terminal::Size().dimy - 2));
+}
+
+// A track that stops being ready while at EOF finished on its own; advance to the next one.
+void Interface::onSnapshot(const PlayerSnapshot &snap) {
+    if (wasReady && !snap.ready && snap.eof) {
+        playNext();
+    }
+    wasReady = snap.ready;
+}
+
+bool Interface::onEvent(const ftxui::Event &event) {
+    using ftxui::Event;
+    if (event == Event::Custom) {
+        onSnapshot(device.getSnapshot());
+        return true;
+    }
+    if (event == Event::Character('q') || event == Event::Escape) {
+        screen.Exit();
+        return true;
+    }
+    if (event == Event::ArrowUp) {
+        selected = selected ? selected - 1 : 0;
+        prefetchVisible();
+    } else if (event == Event::ArrowDown) {
+        selected = std::min(selected + 1, trackCount() ? trackCount() - 1 : 0);
+        prefetchVisible();
+    } else if (event == Event::Return) {
+        playIndex(selected);
+    } else if (event == Event::Character(' ')) {
+        device.togglePlayback();
+    } else if (event == Event::ArrowLeft) {
+        device.seekTo(device.getSnapshot().timestamp - InterfaceSpecifiers::seekStep);
+    } else if (event == Event::ArrowRight) {
+        device.seekTo(device.getSnapshot().timestamp + InterfaceSpecifiers::seekStep);
+    } else if (event == Event::Character('+') || event == Event::Character('=')) {
+        device.incVol(InterfaceSpecifiers::volumeStep);
+    } else if (event == Event::Character('-')) {
+        device.decVol(InterfaceSpecifiers::volumeStep);
+    } else if (event == Event::Character('l')) {
+        device.toggleLooping();
+    } else if (event == Event::Character('m')) {
+        device.toggleMute();
+    } else if (event == Event::Character('n')) {
+        playNext();
+    } else if (event == Event::Character('p')) {
+        playIndex(queue.previous(playing).value_or(playing));
+    } else if (event == Event::Character('s')) {
+        queue.setShuffle(!queue.isShuffled());
+    } else if (event == Event::Character('a')) {
+        queue.enqueue(selected);
+    } else {
+        return onPlaylistEvent(event);
+    }
+    return true;
+}
+
+// i appends the selected track to the playlist, x removes the selected playlist entry, w writes the playlist back
+// to its JSON file. Until then edits live in the playlist's journal and survive restarts.
+bool Interface::onPlaylistEvent(const ftxui::Event &event) {
+    using ftxui::Event;
+    const bool edit{
+        event == Event::Character('i') || event == Event::Character('x') || event == Event::Character('w')
+    };
+    if (!playlist || !edit) {
+        return false;
+    }
+    try {
+        if (event == Event::Character('i') && selected < trackCount()) {
+            playlist->append(std::filesystem::absolute(trackAt(selected)));
+            queue.resize(trackCount());
+            notice.clear();
+        } else if (event == Event::Character('x') && selected >= library.size() && selected < trackCount()) {
+            playlist->remove(selected - library.size());
+            queue.remove(selected);
+            playing = playing > selected ? playing - 1 : playing;
+            selected = std::min(selected, trackCount() ? trackCount() - 1 : 0);
+            prefetchVisible();
+            notice.clear();
+        } else if (event == Event::Character('w')) {
+            playlist->save();
+            notice = "playlist saved";
+        }
+    } catch (const std::exception &e) {
+        notice = e.what();
+    }
+    return true;
+}
+
+ftxui::Element Interface::render() {
+    using namespace ftxui;
+    const PlayerSnapshot snap{device.getSnapshot()};
+
+    // Only the window around the cursor is built, so a frame costs the same for 50 tracks or 50,000.
+    const std::size_t visible{visibleRows()};
+    std::size_t first{selected > visible / 2 ? selected - visible / 2 : 0};
+    const std::size_t count{trackCount()};
+    first = std::min(first, count > visible ? count - visible : 0);
+    const std::size_t last{std::min(count, first + visible)};
+    Elements rows{};
+    rows.reserve(last - first);
+    for (std::size_t i{first}; i < last; ++i) {
+        Element row{text(std::format("{:>4}  {}", i + 1, asU8(trackAt(i).filename())))};
+        if (snap.ready && i == playing) {
+            row = row | bold;
+        }
+        if (i == selected) {
+            row = row | inverted | focus;
+        }
+        rows.push_back(row);
+    }
+    if (rows.empty()) {
+        rows.push_back(text("No audio files found.") | dim);
+    }
+
+    const float progress{snap.duration > 0.0f ? std::clamp(snap.timestamp / snap.duration, 0.0f, 1.0f) : 0.0f};
+    const std::string title{snap.ready ? asU8(snap.filePath().filename()) : std::string{"Nothing playing"}};
+    const std::shared_ptr<const Thumbnail> thumb{snap.ready ? art.get(snap.filePath()) : nullptr};
+    const std::string listStatus{
+        playlist ? std::format("{}: {} edits unsaved", playlist->getName(), playlist->pendingEdits()) : std::string{}
+    };
+    return hbox({
+               vbox({
+                   renderArt(thumb.get()),
+                   separator(),
+                   hbox({text(snap.ready && snap.playback ? " > " : " | "), text(title) | bold, filler()}),
+                   hbox({
+                       text(formatTime(snap.timestamp) + " "),
+                       gauge(progress) | flex,
+                       text(" " + formatTime(snap.duration)),
+                   }),
+                   hbox({
+                       text(std::format("vol {:3.0f}%", snap.volume * 100.0f)),
+                       text(snap.looping ? "  loop" : ""),
+                       text(snap.muted ? "  muted" : ""),
+                       text(queue.isShuffled() ? "  shuffle" : ""),
+                       text(queue.queued() ? std::format("  +{} queued", queue.queued()) : ""),
+                       filler(),
+                   }),
+                   filler(),
+                   text(notice) | dim,
+                   text(listStatus) | dim,
+                   text(std::format("track {}/{}", count ? selected + 1 : 0, count)) | dim,
+                   text(std::format("underruns {}  dropped {}", snap.underruns, snap.droppedCommands)) | dim,
+               }) | size(WIDTH, EQUAL, CoverArtSpecifiers::columns),
+               separator(),
+               vbox(rows) | frame | flex,
+           }) |
+           border;
+}
+
+// Two pixels per cell: the upper half block takes the top pixel as foreground and the bottom one as background.
+ftxui::Element Interface::renderArt(const Thumbnail *thumb) const {
+    using namespace ftxui;
+    if (!thumb) {
+        return text("") | size(WIDTH, EQUAL, CoverArtSpecifiers::columns) |
+               size(HEIGHT, EQUAL, CoverArtSpecifiers::rows);
+    }
+    Elements lines{};
+    for (int y{}; y < thumb->height; y += 2) {
+        Elements cells{};
+        for (int x{}; x < thumb->width; ++x) {
+            const std::uint8_t *top{thumb->pixel(x, y)};
+            Element cell{text("\u2580") | color(Color::RGB(top[0], top[1], top[2]))};
+            if (y + 1 < thumb->height) {
+                const std::uint8_t *bottom{thumb->pixel(x, y + 1)};
+                cell = cell | bgcolor(Color::RGB(bottom[0], bottom[1], bottom[2]));
+            }
+            cells.push_back(cell);
+        }
+        lines.push_back(hbox(cells));
+    }
+    return vbox(lines) | center | size(WIDTH, EQUAL, CoverArtSpecifiers::columns) |
+           size(HEIGHT, EQUAL, CoverArtSpecifiers::rows);
+}
+
+} // namespace trm
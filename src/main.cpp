@@ -2,40 +2,192 @@
 #include <Windows.h>
 #endif
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <exception>
+#include <filesystem>
+#include <format>
 #include <iostream>
-#include <thread>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
+#include "equalizer.hpp"
+#include "exporter.hpp"
+#include "interface.hpp"
 #include "maudio.hpp"
+#include "telemetry.hpp"
 #include "utils.hpp"
 
-int main() {
+namespace {
+
+// tmplay --export <outdir> [-j <threads>] [-m <MiB>] <inputs...>
+int runExport(const int argc, char **argv) {
+    trm::require(argc >= 4, trm::Error::INVALID_ARGUMENT);
+    trm::ExportOptions opts{.outputDir = argv[2]};
+    for (int i{3}; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "-j" || arg == "-m") {
+            trm::require(i + 1 < argc, trm::Error::INVALID_ARGUMENT);
+            const std::size_t value{static_cast<std::size_t>(std::stoull(argv[++i]))};
+            if (arg == "-j") {
+                opts.threads = value;
+            } else {
+                opts.memoryBudget = value * 1024 * 1024;
+            }
+            continue;
+        }
+        opts.inputs.emplace_back(arg);
+    }
+    trm::BatchExporter exporter{std::move(opts)};
+    const trm::ExportStats stats{exporter.run()};
+    std::cout << std::format(
+        "{}/{} files | {:.1f} s audio in {:.2f} s | {:.1f}x realtime | {:.1f} MB/s\n",
+        stats.files - stats.failed, stats.files, stats.audioSeconds, stats.wallSeconds, stats.realtimeFactor(),
+        stats.mbPerSecond()
+    );
+    return stats.failed ? 1 : 0;
+}
+
+// tmplay --bench-eq
+// Measures equalizer cost per frame as bands are added, using the same block size as the decode thread.
+int runEqBenchmark() {
+    constexpr std::size_t seconds{20};
+    constexpr std::size_t samplesPerSecond{trm::MaDeviceSpecifiers::sampleRate * trm::MaDeviceSpecifiers::channels};
+    constexpr std::size_t chunk{trm::EqSpecifiers::blockFrames * trm::MaDeviceSpecifiers::channels};
+    std::vector<std::int16_t> input(seconds * samplesPerSecond);
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> noise{-8000, 8000};
+    for (std::int16_t &sample : input) {
+        sample = static_cast<std::int16_t>(noise(rng));
+    }
+
+    double baseNs{};
+    std::cout << "bands | ns/frame | ns/frame/band | x realtime\n";
+    for (std::size_t bands{}; bands <= trm::EqSpecifiers::maxBands; ++bands) {
+        trm::Equalizer eq{};
+        for (std::size_t i{}; i < bands; ++i) {
+            eq.setBand(i, {.frequency = 40.0f * static_cast<float>(1 << i), .gain = 3.0f, .q = 1.0f, .enabled = true});
+        }
+        std::vector<std::int16_t> work{input};
+        // Let coefficient smoothing converge so only steady-state filtering is timed.
+        eq.process(work.data(), samplesPerSecond);
+        work = input;
+        const auto begin{std::chrono::steady_clock::now()};
+        for (std::size_t offset{}; offset < work.size(); offset += chunk) {
+            eq.process(work.data() + offset, std::min(chunk, work.size() - offset));
+        }
+        const std::chrono::duration<double, std::nano> elapsed{std::chrono::steady_clock::now() - begin};
+        const double nsPerFrame{elapsed.count() / (seconds * trm::MaDeviceSpecifiers::sampleRate)};
+        if (!bands) {
+            baseNs = nsPerFrame;
+        }
+        std::cout << std::format(
+            "{:5} | {:8.2f} | {:13.2f} | {:.0f}\n", bands, nsPerFrame,
+            bands ? (nsPerFrame - baseNs) / bands : 0.0, seconds * 1e9 / elapsed.count()
+        );
+    }
+    return 0;
+}
+
+// tmplay --bench-telemetry [tracks] [years]
+// Replays a synthetic listening history through the store and times ingest, compaction, reload and queries.
+int runTelemetryBenchmark(const int argc, char **argv) {
+    using Clock = std::chrono::steady_clock;
+    const auto since{[](const Clock::time_point begin) {
+        return std::chrono::duration<double>(Clock::now() - begin).count();
+    }};
+    const std::size_t tracks{argc > 2 ? static_cast<std::size_t>(std::stoull(argv[2])) : 20000};
+    const double years{argc > 3 ? std::stod(argv[3]) : 5.0};
+    trm::require(tracks > 0 && years > 0.0, trm::Error::INVALID_ARGUMENT);
+    const std::uint64_t endTime{trm::PlaybackTelemetry::now()};
+    const std::filesystem::path dir{std::filesystem::temp_directory_path() / std::format("tmplay-bench-{}", endTime)};
+
+    Clock::time_point begin{Clock::now()};
+    const std::vector<trm::PlaybackEvent> history{trm::synthesizeHistory(tracks, years, endTime, 42)};
+    std::cout << std::format("generate | {} events in {:.2f} s\n", history.size(), since(begin));
+    {
+        trm::PlaybackTelemetry store{dir};
+        begin = Clock::now();
+        store.ingest(history);
+        const double ingestSeconds{since(begin)};
+        std::cout << std::format(
+            "ingest   | {:.2f} s | {:.1f} M events/s\n", ingestSeconds, history.size() / ingestSeconds / 1e6
+        );
+        begin = Clock::now();
+        store.compact();
+        std::cout << std::format("compact  | {:.3f} s | {} tracks\n", since(begin), store.trackCount());
+    }
+
+    {
+        begin = Clock::now();
+        trm::PlaybackTelemetry store{dir};
+        std::cout << std::format("reload   | {:.3f} s\n", since(begin));
+
+        constexpr std::size_t queries{100000};
+        std::mt19937_64 rng{7};
+        std::uniform_int_distribution<std::size_t> pick{0, history.size() - 1};
+        std::vector<double> latencies(queries);
+        for (double &latency : latencies) {
+            const std::uint64_t track{history[pick(rng)].track};
+            begin = Clock::now();
+            const std::optional<trm::TrackStats> stats{store.query(track)};
+            latency = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+            trm::require(stats.has_value(), trm::Error::FILE_READ);
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << std::format(
+            "query    | p50 {:.2f} us | p99 {:.2f} us | p999 {:.2f} us\n", latencies[queries / 2],
+            latencies[queries * 99 / 100], latencies[queries * 999 / 1000]
+        );
+
+        constexpr int rankRuns{20};
+        begin = Clock::now();
+        std::vector<trm::RankedTrack> top{};
+        for (int i{}; i < rankRuns; ++i) {
+            top = store.rank(50, endTime);
+        }
+        std::cout << std::format(
+            "rank     | top {} of {} in {:.0f} us\n", top.size(), store.trackCount(), since(begin) * 1e6 / rankRuns
+        );
+    }
+    std::error_code ec{};
+    std::filesystem::remove_all(dir, ec);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
 #endif
     std::ios_base::sync_with_stdio(false);
     try {
+        if (argc > 1 && std::string_view{argv[1]} == "--export") {
+            return runExport(argc, argv);
+        }
+        if (argc > 1 && std::string_view{argv[1]} == "--bench-eq") {
+            return runEqBenchmark();
+        }
+        if (argc > 1 && std::string_view{argv[1]} == "--bench-telemetry") {
+            return runTelemetryBenchmark(argc, argv);
+        }
+        std::vector<std::filesystem::path> paths(argv + 1, argv + argc);
+        if (paths.empty()) {
+            paths.push_back(std::filesystem::current_path());
+        }
+        trm::PlaybackTelemetry telemetry{trm::dataDirectory() / "telemetry"};
         trm::AudioDevice aud{};
-        aud.start(
-            u8"C:\\Users\\A22\\Music\\Dreycruz ft. Bert Symoun - Wag Ipagsabi (Official Music Video) [hA-fTsi0eyg].m4a"
-        );
-        aud.play();
-        aud.setVol(1.0f);
-        aud.seekTo(100.0f);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        while (!aud.isEof()) {
-            std::cout << std::format("{:.2f} s | {}", aud.getTimestamp(), aud.isEof() ? "EOF " : "NEOF") << '\r';
-            std::this_thread::sleep_for(std::chrono::milliseconds(150));
-        }
-        aud.start(u8"C:\\Users\\A22\\Music\\AOA - 짧은 치마 (Miniskirt) M⧸V [q6f-LLM1H6U].m4a");
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        while (!aud.isEof()) {
-            std::cout << std::format("{:.2f} s | {}", aud.getTimestamp(), aud.isEof() ? "EOF " : "NEOF") << '\r';
-            std::this_thread::sleep_for(std::chrono::milliseconds(150));
-        }
-        std::cout << "Hello World!\n";
+        aud.setTelemetry(&telemetry);
+        trm::Interface ui{aud, paths};
+        ui.run();
     } catch (const std::exception &e) {
         trm::showError(e.what());
+        return 1;
     }
-}
\ No newline at end of file
+}
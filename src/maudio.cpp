@@ -1,14 +1,20 @@
 #define MINIAUDIO_IMPLEMENTATION
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
 
 #include "maudio.hpp"
 #include "utils.hpp"
 
 namespace trm {
 
-AudioDevice::AudioDevice() {
+// A specific backend (e.g. ma_backend_null for headless runs) gets its own context; otherwise miniaudio picks one.
+AudioDevice::AudioDevice(const std::optional<ma_backend> backend) {
     device.devConfig.playback.format = MaDeviceSpecifiers::format;
     device.devConfig.playback.channels = MaDeviceSpecifiers::channels;
     device.devConfig.sampleRate = MaDeviceSpecifiers::sampleRate;
@@ -16,19 +22,38 @@ AudioDevice::AudioDevice() {
     device.devConfig.dataCallback = device.callback;
     device.devConfig.pUserData = static_cast<void *>(this);
 
-    require(ma_device_init(nullptr, &device.devConfig, &device.dev) == MA_SUCCESS, Error::MA_INIT);
-    require(ma_device_start(&device.dev) == MA_SUCCESS, Error::MA_INIT);
-
-    internalThread = std::thread([this] { this->pThread(); });
+    if (backend) {
+        const std::array<ma_backend, 1> backends{*backend};
+        require(ma_context_init(backends.data(), 1, nullptr, &device.context) == MA_SUCCESS, Error::MA_INIT);
+        device.ownsContext = true;
+    }
+    ma_context *context{device.ownsContext ? &device.context : nullptr};
+    const bool initialized{ma_device_init(context, &device.devConfig, &device.dev) == MA_SUCCESS};
+    try {
+        require(initialized && ma_device_start(&device.dev) == MA_SUCCESS, Error::MA_INIT);
+        internalThread = std::thread([this] { this->pThread(); });
+    } catch (...) {
+        // The destructor does not run for a constructor that throws, so whatever miniaudio set up is released here.
+        if (initialized) {
+            ma_device_uninit(&device.dev);
+        }
+        if (device.ownsContext) {
+            ma_context_uninit(&device.context);
+        }
+        throw;
+    }
 }
 
 AudioDevice::~AudioDevice() {
     state.terminate.store(true);
-    state.condition.notify_one();
+    state.wake();
     if (internalThread.joinable()) {
         internalThread.join();
     }
     ma_device_uninit(&device.dev);
+    if (device.ownsContext) {
+        ma_context_uninit(&device.context);
+    }
 }
 
 void AudioDevice::play([[maybe_unused]] const Command &command) { state.playback.store(true); }
@@ -39,12 +64,23 @@ void AudioDevice::togglePlayback([[maybe_unused]] const Command &command) {
 void AudioDevice::toggleMute([[maybe_unused]] const Command &command) { state.muted.store(!state.muted.load()); }
 void AudioDevice::toggleLooping([[maybe_unused]] const Command &command) { state.looping.store(!state.looping.load()); }
 void AudioDevice::seekTo(const Command &command) {
+    // A default Decoder has no stream to seek in: nothing started yet, or the last start() failed.
+    if (!state.ready.load() || !state.decoder.isReady()) {
+        return;
+    }
     {
         std::lock_guard<std::mutex> lock{state.queueMutex};
         state.flushSampleQueue();
     }
     state.flushStagingQueue();
-    state.decoder.seekTo(command.fVal.value_or(0.0f));
+    record(PlaybackEventType::SEEK, state.data.timestamp.load(), command.fVal.value_or(0.0f));
+    try {
+        state.decoder.seekTo(command.fVal.value_or(0.0f));
+    } catch (const std::exception &) {
+        dropTrack();
+        return;
+    }
+    state.equalizer.reset();
 }
 void AudioDevice::setVol(const Command &command) { state.volume.store(command.fVal.value_or(0.0f)); }
 void AudioDevice::incVol(const Command &command) {
@@ -54,19 +90,36 @@ void AudioDevice::decVol(const Command &command) {
     state.volume.store(std::max(0.0f, state.volume.load() - command.fVal.value_or(0.0f)));
 }
 void AudioDevice::start([[maybe_unused]] const Command &command) {
+    recordStop();
+    state.ready.store(false);
     {
         std::lock_guard<std::mutex> lock{state.queueMutex};
         state.flushSampleQueue();
     }
     state.flushStagingQueue();
     require(command.pVal.has_value(), Error::INVALID_COMMAND);
-    state.decoder = Decoder{command.pVal.value()};
+    ++state.published.trackId;
+    const std::string u8{asU8(command.pVal.value())};
+    state.published.setPath(u8);
+    state.trackHash = fnv1a(u8);
+    try {
+        state.decoder = Decoder{command.pVal.value()};
+    } catch (const std::exception &) {
+        dropTrack();
+        return;
+    }
+    state.equalizer.reset();
     state.data.timestamp.store(0.0f);
     state.data.duration.store(state.decoder.getFileDuration());
     state.eof.store(false);
     state.ready.store(true);
+    if (PlaybackTelemetry *sink{state.telemetry.load()}) {
+        sink->nameTrack(state.trackHash, u8);
+    }
+    record(PlaybackEventType::START, 0.0f, state.data.duration.load());
 }
 void AudioDevice::end([[maybe_unused]] const Command &command) {
+    recordStop();
     state.ready.store(false);
     {
         std::lock_guard<std::mutex> lock{state.queueMutex};
@@ -77,40 +130,69 @@ void AudioDevice::end([[maybe_unused]] const Command &command) {
     state.eof.store(true);
 }
 
+// Decoder failures must not take down the playback thread. The track is ended and readers see ready == false.
+void AudioDevice::dropTrack() {
+    state.decoder = Decoder{};
+    end(Command{});
+}
+
 void AudioDevice::pThread() {
     while (!state.terminate.load()) {
-        {
-            std::unique_lock<std::mutex> lock{state.commandMutex};
-            state.condition.wait(lock, [this] {
-                return this->state.terminate.load() || !this->state.commandQueue.empty() ||
-                       this->state.cQueueSamples.load() < MaDeviceSpecifiers::queueLimit || 
-                       (this->state.decoder.eof() && (state.cQueueSamples.load() == 0 || state.looping.load()));
-            });
-            while (!state.commandQueue.empty()) {
-                Command &com{state.commandQueue.front()};
-                switch (com.commandType) {
-                case CommandType::PLAY: play(com); break;
-                case CommandType::PAUSE: pause(com); break;
-                case CommandType::TOGGLE_PLAYBACK: togglePlayback(com); break;
-                case CommandType::TOGGLE_MUTE: toggleMute(com); break;
-                case CommandType::TOGGLE_LOOPING: toggleLooping(com); break;
-                case CommandType::SEEK_TO: seekTo(com); break;
-                case CommandType::START: start(com); break;
-                case CommandType::END: end(com); break;
-                case CommandType::SET_VOL: setVol(com); break;
-                case CommandType::INC_VOL: incVol(com); break;
-                case CommandType::DEC_VOL: decVol(com); break;
-                case CommandType::NULL_T: break;
-                }
-                state.commandQueue.pop();
+        const std::uint32_t seen{state.wakeups.load()};
+        const bool hasWork{
+            !state.commandQueue.empty() ||
+            (!state.stagingQueue.empty() && state.cQueueSamples.load() < MaDeviceSpecifiers::queueLimit) ||
+            (state.decoder.isReady() && !state.decoder.eof() &&
+             state.stagingQueue.size() < MaDeviceSpecifiers::queueLimit) ||
+            (state.ready.load() && state.decoder.eof() && (state.cQueueSamples.load() == 0 || state.looping.load()))
+        };
+        // Any wake() after `seen` was read makes this return immediately, so no wakeup is lost.
+        if (!hasWork && !state.terminate.load()) {
+            state.wakeups.wait(seen);
+            continue;
+        }
+        while (std::optional<Command> com{state.commandQueue.pop()}) {
+            switch (com->commandType) {
+            case CommandType::PLAY: play(*com); break;
+            case CommandType::PAUSE: pause(*com); break;
+            case CommandType::TOGGLE_PLAYBACK: togglePlayback(*com); break;
+            case CommandType::TOGGLE_MUTE: toggleMute(*com); break;
+            case CommandType::TOGGLE_LOOPING: toggleLooping(*com); break;
+            case CommandType::SEEK_TO: seekTo(*com); break;
+            case CommandType::START: start(*com); break;
+            case CommandType::END: end(*com); break;
+            case CommandType::SET_VOL: setVol(*com); break;
+            case CommandType::INC_VOL: incVol(*com); break;
+            case CommandType::DEC_VOL: decVol(*com); break;
+            case CommandType::NULL_T: break;
             }
         }
-        if (state.decoder.eof() && this->state.looping) {
-            state.decoder = Decoder{state.decoder.getFilePath()};
+        if (state.ready.load() && state.decoder.eof() && state.looping.load()) {
+            record(PlaybackEventType::LOOP, state.data.duration.load(), state.data.duration.load());
+            try {
+                state.decoder = Decoder{state.decoder.getFilePath()};
+            } catch (const std::exception &) {
+                dropTrack();
+            }
         }
+        // Decoded and equalized in blocks here so the device callback only has to copy and scale.
+        std::array<std::int16_t, EqSpecifiers::blockFrames * MaDeviceSpecifiers::channels> block{};
         while (state.stagingQueue.size() < MaDeviceSpecifiers::queueLimit && !state.decoder.eof() &&
                state.decoder.isReady()) {
-            state.stagingQueue.push(state.decoder.getSample().value_or(0.0f));
+            const std::size_t want{
+                std::min(block.size(), MaDeviceSpecifiers::queueLimit - state.stagingQueue.size())
+            };
+            std::size_t got{};
+            try {
+                got = state.decoder.getSamples(block.data(), want);
+            } catch (const std::exception &) {
+                dropTrack();
+                break;
+            }
+            state.equalizer.process(block.data(), got);
+            for (std::size_t i{}; i < got; ++i) {
+                state.stagingQueue.push(block[i]);
+            }
             state.data.timestamp.store(state.decoder.getCurrentTimestamp());
             state.eof.store(state.decoder.eof());
         }
@@ -120,35 +202,94 @@ void AudioDevice::pThread() {
                 state.qPushSync(state.stagingQueue.front());
                 state.stagingQueue.pop();
             }
+            if (!state.sampleQueue.empty()) {
+                state.primed.store(true);
+            }
         }
         if (state.eof.load() && !state.looping.load() && state.cQueueSamples.load() == 0 && state.ready.load()) {
             end(Command{});
         }
+        publishSnapshot();
+    }
+}
+
+// Telemetry hooks. pThread only; emit() never blocks.
+void AudioDevice::record(const PlaybackEventType type, const float position, const float value) {
+    if (PlaybackTelemetry *sink{state.telemetry.load()}) {
+        sink->emit({
+            .time = PlaybackTelemetry::now(),
+            .track = state.trackHash,
+            .position = position,
+            .value = value,
+            .type = type,
+        });
+    }
+}
+
+// A track leaving the device counts as an END once fully decoded and as a SKIP otherwise.
+void AudioDevice::recordStop() {
+    if (state.ready.load()) {
+        const PlaybackEventType type{state.eof.load() ? PlaybackEventType::END : PlaybackEventType::SKIP};
+        record(type, state.data.timestamp.load(), state.data.duration.load());
+    }
+}
+
+// Republishes the reader-facing snapshot if anything visible changed. pThread only.
+void AudioDevice::publishSnapshot() {
+    PlayerSnapshot &snap{state.published};
+    const PlayerSnapshot previous{snap};
+    snap.timestamp = state.data.timestamp.load();
+    snap.duration = state.data.duration.load();
+    snap.volume = state.volume.load();
+    snap.underruns = state.underruns.load();
+    snap.droppedCommands = state.droppedCommands.load();
+    snap.queuedSamples = static_cast<std::uint32_t>(state.cQueueSamples.load());
+    snap.playback = state.playback.load();
+    snap.muted = state.muted.load();
+    snap.looping = state.looping.load();
+    snap.ready = state.ready.load();
+    snap.eof = state.eof.load();
+    if (!(snap == previous)) {
+        state.snapshot.store(snap);
     }
 }
 
+// Truncates on a UTF-8 code point boundary if the path does not fit.
+void PlayerSnapshot::setPath(const std::string &u8) {
+    std::size_t n{std::min(u8.size(), maxPathBytes)};
+    while (n && n < u8.size() && (static_cast<unsigned char>(u8[n]) & 0xC0) == 0x80) {
+        --n;
+    }
+    std::memcpy(path.data(), u8.data(), n);
+    pathBytes = static_cast<std::uint32_t>(n);
+}
+
+void DeviceState::wake() {
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+}
+
 void DeviceState::flushStagingQueue() {
     while (!stagingQueue.empty()) {
         stagingQueue.pop();
     }
 }
 
+// An empty queue right after a flush is pThread catching up, not an underrun; counting waits for the next push.
 void DeviceState::flushSampleQueue() {
     while (!sampleQueue.empty()) {
         qPopSync();
     }
+    primed.store(false);
 }
 
+// Never blocks. Commands are dropped (and counted) if pThread has fallen behind.
 void AudioDevice::sendCommand(const Command &command) {
-    constexpr std::size_t commandLimit{5};
-    {
-        std::lock_guard<std::mutex> lock{state.commandMutex};
-        if (state.commandQueue.size() >= commandLimit) {
-            return;
-        }
-        state.commandQueue.push(command);
+    if (!state.commandQueue.push(command)) [[unlikely]] {
+        ++state.droppedCommands;
+        return;
     }
-    state.condition.notify_one();
+    state.wake();
 }
 
 void AudioDevice::play() {
@@ -203,6 +344,9 @@ void MaDevice::callback(ma_device *device, void *out, [[maybe_unused]] const voi
     std::uint32_t framesServed{};
     std::int16_t *sampleOut{static_cast<std::int16_t *>(out)};
     if (state.muted || !state.playback || !state.cQueueSamples.load() || !state.ready) {
+        if (state.playback && state.ready && !state.muted && !state.eof && state.primed) {
+            ++state.underruns;
+        }
         std::fill(sampleOut, sampleOut + tFrameCount, 0);
         return;
     }
@@ -218,9 +362,12 @@ void MaDevice::callback(ma_device *device, void *out, [[maybe_unused]] const voi
         }
     }
     if (framesServed != tFrameCount) [[unlikely]] {
+        if (!state.eof && state.primed) {
+            ++state.underruns;
+        }
         std::fill(sampleOut + framesServed, sampleOut + tFrameCount, 0);
     }
-    state.condition.notify_one();
+    state.wake();
 }
 
 // Not thread-safe. Modifies the state queue. Must be used within a mutex.
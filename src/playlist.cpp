@@ -0,0 +1,556 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "playlist.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+struct SnapshotHeader {
+    std::uint32_t magic{PlaylistSpecifiers::snapshotMagic};
+    std::uint32_t version{PlaylistSpecifiers::version};
+    std::uint64_t stamp{};
+    std::uint64_t nameBytes{};
+    std::uint64_t arenaBytes{};
+    std::uint64_t spans{};
+    std::uint64_t entries{};
+};
+
+struct JournalHeader {
+    std::uint32_t magic{PlaylistSpecifiers::journalMagic};
+    std::uint32_t version{PlaylistSpecifiers::version};
+    std::uint64_t stamp{};
+};
+
+struct JournalRecord {
+    PlaylistOp op{};
+    std::array<std::uint8_t, 3> reserved{};
+    std::uint32_t a{};
+    std::uint32_t b{};
+    std::uint32_t length{};
+};
+
+template <typename T> bool readPod(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template <typename T> void writePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool readArray(std::istream &in, std::vector<T> &values, const std::size_t count) {
+    values.resize(count);
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)))
+    );
+}
+
+template <typename T> void writeArray(std::ostream &out, const std::vector<T> &values) {
+    out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+bool readBytes(std::istream &in, std::string &value, const std::size_t count) {
+    value.resize(count);
+    return static_cast<bool>(in.read(value.data(), static_cast<std::streamsize>(count)));
+}
+
+} // namespace
+
+// Keyed by FNV-1a; a colliding string probes forward to the next free key.
+std::uint32_t StringPool::intern(const std::string_view value) {
+    for (std::uint64_t key{fnv1a(value)};; ++key) {
+        const auto [it, inserted]{index.try_emplace(key, static_cast<std::uint32_t>(spans.size()))};
+        if (inserted) {
+            spans.emplace_back(static_cast<std::uint32_t>(arena.size()), static_cast<std::uint32_t>(value.size()));
+            arena.append(value);
+            return it->second;
+        }
+        if (view(it->second) == value) {
+            return it->second;
+        }
+    }
+}
+
+void StringPool::reindex() {
+    index.clear();
+    index.reserve(spans.size());
+    for (std::uint32_t id{}; id < spans.size(); ++id) {
+        std::uint64_t key{fnv1a(view(id))};
+        while (!index.try_emplace(key, id).second) {
+            ++key;
+        }
+    }
+}
+
+void StringPool::clear() {
+    arena.clear();
+    spans.clear();
+    index.clear();
+}
+
+// Streams tracks straight into the playlist; no DOM is built.
+struct PlaylistSax : nlohmann::json_sax<nlohmann::json> {
+    Playlist &list;
+    std::size_t depth{};
+    std::size_t tracksDepth{}; // Depth of the track array's elements, 0 outside of it.
+    std::uint32_t elements{};  // Values seen so far in the track array, tracks or not.
+    std::string lastKey{};
+    explicit PlaylistSax(Playlist &target) : list{target} {}
+    bool value() {
+        if (tracksDepth && depth == tracksDepth) {
+            ++elements;
+        }
+        return true;
+    }
+    bool null() override { return value(); }
+    bool boolean(bool) override { return value(); }
+    bool number_integer(number_integer_t) override { return value(); }
+    bool number_unsigned(number_unsigned_t) override { return value(); }
+    bool number_float(number_float_t, const string_t &) override { return value(); }
+    bool binary(binary_t &) override { return value(); }
+    bool string(string_t &value) override {
+        this->value();
+        if (tracksDepth && (depth == tracksDepth || (depth == tracksDepth + 1 && lastKey == "path"))) {
+            list.applyInsert(list.entries.size(), value, elements - 1);
+        } else if (depth == 1 && lastKey == "name") {
+            list.name = value;
+        }
+        return true;
+    }
+    bool key(string_t &value) override {
+        lastKey = value;
+        return true;
+    }
+    bool start_object(std::size_t) override {
+        value();
+        ++depth;
+        return true;
+    }
+    bool end_object() override {
+        --depth;
+        lastKey.clear();
+        return true;
+    }
+    bool start_array(std::size_t) override {
+        value();
+        if (!tracksDepth && (depth == 0 || (depth == 1 && lastKey == "tracks"))) {
+            tracksDepth = depth + 1;
+        }
+        ++depth;
+        return true;
+    }
+    bool end_array() override {
+        if (depth == tracksDepth) {
+            tracksDepth = 0;
+        }
+        --depth;
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &) override { return false; }
+};
+
+Playlist::Playlist(std::filesystem::path file) : source{std::move(file)}, name{asU8(source.stem())} {
+    std::error_code ec{};
+    const std::string key{std::format("{:016x}", fnv1a(asU8(std::filesystem::absolute(source, ec))))};
+    snapshotPath = cacheDirectory() / "playlists" / (key + ".bin");
+    journalPath = dataDirectory() / "playlists" / (key + ".journal");
+    std::filesystem::create_directories(snapshotPath.parent_path(), ec);
+    std::filesystem::create_directories(journalPath.parent_path(), ec);
+
+    stamp = sourceStamp();
+    if (std::filesystem::is_regular_file(source, ec) && !readSnapshot()) {
+        parse();
+        writeSnapshot();
+    }
+    replayJournal();
+}
+
+std::uint64_t Playlist::sourceStamp() const {
+    std::error_code ec{};
+    const std::uintmax_t size{std::filesystem::file_size(source, ec)};
+    if (ec) {
+        return 0;
+    }
+    const auto modified{std::filesystem::last_write_time(source, ec).time_since_epoch().count()};
+    return fnv1a(std::format("{}|{}", size, modified));
+}
+
+void Playlist::parse() {
+    std::ifstream in{source, std::ios::binary};
+    require(in.is_open(), Error::FILE_READ);
+    PlaylistSax sax{*this};
+    require(nlohmann::json::sax_parse(in, &sax), Error::PLAYLIST_PARSE);
+}
+
+// The snapshot is the parsed form laid out flat, so loading it is a handful of reads plus a rehash of the pool.
+bool Playlist::readSnapshot() {
+    std::ifstream in{snapshotPath, std::ios::binary};
+    SnapshotHeader header{};
+    if (!readPod(in, header) || header.magic != PlaylistSpecifiers::snapshotMagic ||
+        header.version != PlaylistSpecifiers::version || header.stamp != stamp) {
+        return false;
+    }
+    // Sizes are checked against the file before anything is allocated from them.
+    std::error_code ec{};
+    const std::uintmax_t fileBytes{std::filesystem::file_size(snapshotPath, ec)};
+    const std::uintmax_t payload{
+        header.nameBytes + header.arenaBytes + header.spans * sizeof(pool.spans[0]) +
+        header.entries * sizeof(PlaylistEntry)
+    };
+    if (ec || header.spans > fileBytes || header.entries > fileBytes || payload > fileBytes) {
+        return false;
+    }
+    std::string title{};
+    if (!readBytes(in, title, header.nameBytes) || !readBytes(in, pool.arena, header.arenaBytes) ||
+        !readArray(in, pool.spans, header.spans) || !readArray(in, entries, header.entries)) {
+        pool.clear();
+        entries.clear();
+        return false;
+    }
+    const bool valid{
+        std::all_of(
+            pool.spans.begin(), pool.spans.end(),
+            [&](const auto &span) { return std::uint64_t{span.first} + span.second <= pool.arena.size(); }
+        ) &&
+        std::all_of(entries.begin(), entries.end(), [&](const PlaylistEntry &e) {
+            return e.dir < pool.spans.size() && e.file < pool.spans.size();
+        })
+    };
+    if (!valid) [[unlikely]] {
+        pool.clear();
+        entries.clear();
+        return false;
+    }
+    name = std::move(title);
+    pool.reindex();
+    return true;
+}
+
+void Playlist::writeSnapshot() const {
+    const std::filesystem::path tmp{std::filesystem::path{snapshotPath} += ".tmp"};
+    {
+        std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+        if (!out.is_open()) {
+            return;
+        }
+        writePod(
+            out,
+            SnapshotHeader{
+                .stamp = stamp,
+                .nameBytes = name.size(),
+                .arenaBytes = pool.arena.size(),
+                .spans = pool.spans.size(),
+                .entries = entries.size(),
+            }
+        );
+        out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        out.write(pool.arena.data(), static_cast<std::streamsize>(pool.arena.size()));
+        writeArray(out, pool.spans);
+        writeArray(out, entries);
+        if (!out.flush()) {
+            return;
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::rename(tmp, snapshotPath, ec);
+}
+
+// A journal written against another revision of the source is dropped: the file was edited outside of the app.
+// A torn trailing record from an interrupted write is cut off so new records stay aligned.
+void Playlist::replayJournal() {
+    std::ifstream in{journalPath, std::ios::binary};
+    JournalHeader header{};
+    if (!readPod(in, header) || header.magic != PlaylistSpecifiers::journalMagic ||
+        header.version != PlaylistSpecifiers::version || header.stamp != stamp) {
+        in.close();
+        std::error_code ec{};
+        std::filesystem::remove(journalPath, ec);
+        return;
+    }
+    std::streamoff good{in.tellg()};
+    JournalRecord record{};
+    std::string track{};
+    while (readPod(in, record) && record.length <= PlaylistSpecifiers::maxEntryBytes &&
+           readBytes(in, track, record.length)) {
+        switch (record.op) {
+        case PlaylistOp::INSERT:
+            if (record.a <= entries.size()) {
+                applyInsert(record.a, track);
+            }
+            break;
+        case PlaylistOp::REMOVE:
+            if (record.a < entries.size()) {
+                applyRemove(record.a);
+            }
+            break;
+        case PlaylistOp::MOVE:
+            if (record.a < entries.size() && record.b < entries.size()) {
+                applyMove(record.a, record.b);
+            }
+            break;
+        }
+        ++journalOps;
+        good = in.tellg();
+    }
+    in.close();
+    std::error_code ec{};
+    std::filesystem::resize_file(journalPath, static_cast<std::uintmax_t>(good), ec);
+    journal.open(journalPath, std::ios::binary | std::ios::app);
+}
+
+void Playlist::resetJournal() {
+    journal.close();
+    journal.open(journalPath, std::ios::binary | std::ios::trunc);
+    require(journal.is_open(), Error::FILE_WRITE);
+    writePod(journal, JournalHeader{.stamp = stamp});
+    journalOps = 0;
+}
+
+void Playlist::log(const PlaylistOp op, const std::uint32_t a, const std::uint32_t b, const std::string_view track) {
+    if (!journal.is_open()) {
+        resetJournal();
+    }
+    writePod(journal, JournalRecord{.op = op, .a = a, .b = b, .length = static_cast<std::uint32_t>(track.size())});
+    journal.write(track.data(), static_cast<std::streamsize>(track.size()));
+    require(static_cast<bool>(journal.flush()), Error::FILE_WRITE);
+    ++journalOps;
+}
+
+void Playlist::applyInsert(const std::size_t idx, const std::string_view track, const std::uint32_t origin) {
+    const std::size_t split{track.find_last_of("/\\")};
+    const std::size_t dirLength{split == std::string_view::npos ? 0 : split + 1};
+    const PlaylistEntry entry{
+        .dir = pool.intern(track.substr(0, dirLength)),
+        .file = pool.intern(track.substr(dirLength)),
+        .origin = origin,
+    };
+    entries.insert(entries.begin() + static_cast<std::ptrdiff_t>(idx), entry);
+}
+
+void Playlist::applyRemove(const std::size_t idx) { entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(idx)); }
+
+void Playlist::applyMove(const std::size_t from, const std::size_t to) {
+    const auto first{entries.begin()};
+    if (from < to) {
+        std::rotate(first + from, first + from + 1, first + to + 1);
+    } else if (to < from) {
+        std::rotate(first + to, first + from, first + from + 1);
+    }
+}
+
+std::string Playlist::entry(const std::size_t idx) const {
+    std::string out{pool.view(entries[idx].dir)};
+    out += pool.view(entries[idx].file);
+    return out;
+}
+
+std::filesystem::path Playlist::at(const std::size_t idx) const {
+    const std::string u8{entry(idx)};
+    const std::filesystem::path track{std::u8string{reinterpret_cast<const char8_t *>(u8.data()), u8.size()}};
+    return track.is_absolute() ? track : source.parent_path() / track;
+}
+
+std::vector<std::filesystem::path> Playlist::paths() const {
+    std::vector<std::filesystem::path> out{};
+    out.reserve(entries.size());
+    for (std::size_t i{}; i < entries.size(); ++i) {
+        out.push_back(at(i));
+    }
+    return out;
+}
+
+void Playlist::insert(const std::size_t idx, const std::filesystem::path &track) {
+    require(idx <= entries.size(), Error::OUT_OF_RANGE);
+    const std::string u8{asU8(track)};
+    applyInsert(idx, u8);
+    log(PlaylistOp::INSERT, static_cast<std::uint32_t>(idx), 0, u8);
+}
+
+void Playlist::remove(const std::size_t idx) {
+    require(idx < entries.size(), Error::OUT_OF_RANGE);
+    applyRemove(idx);
+    log(PlaylistOp::REMOVE, static_cast<std::uint32_t>(idx), 0, {});
+}
+
+void Playlist::move(const std::size_t from, const std::size_t to) {
+    require(from < entries.size() && to < entries.size(), Error::OUT_OF_RANGE);
+    applyMove(from, to);
+    log(PlaylistOp::MOVE, static_cast<std::uint32_t>(from), static_cast<std::uint32_t>(to), {});
+}
+
+// Folds the journal back into the JSON. The source is re-read so that fields the player ignores survive: each entry
+// that came from the file takes its original element along with only the path rewritten, and elements of the track
+// array that are not tracks stay behind the element they followed. The file is replaced atomically; the pool drops
+// strings no entry uses.
+void Playlist::save() {
+    require(sourceStamp() == stamp, Error::PLAYLIST_STALE);
+    nlohmann::json root{};
+    std::error_code ec{};
+    if (std::filesystem::is_regular_file(source, ec)) {
+        std::ifstream in{source, std::ios::binary};
+        require(in.is_open(), Error::FILE_READ);
+        root = nlohmann::json::parse(in, nullptr, false);
+        require(!root.is_discarded(), Error::PLAYLIST_PARSE);
+    }
+    if (!root.is_array() && !root.is_object()) {
+        root = nlohmann::json{{"name", name}};
+    }
+    nlohmann::json &tracks{root.is_array() ? root : root["tracks"]};
+    if (!tracks.is_array()) {
+        tracks = nlohmann::json::array();
+    }
+
+    // after[0] goes first, after[i + 1] follows entry i.
+    std::vector<std::size_t> entryOf(tracks.size(), entries.size());
+    for (std::size_t i{}; i < entries.size(); ++i) {
+        if (entries[i].origin < tracks.size()) {
+            entryOf[entries[i].origin] = i;
+        }
+    }
+    std::vector<std::vector<nlohmann::json>> after(entries.size() + 1);
+    std::size_t anchor{};
+    for (std::size_t j{}; j < tracks.size(); ++j) {
+        const nlohmann::json &element{tracks[j]};
+        const auto path{element.is_object() ? element.find("path") : element.end()};
+        if (entryOf[j] < entries.size()) {
+            anchor = entryOf[j] + 1;
+        } else if (!element.is_string() && (!element.is_object() || path == element.end() || !path->is_string())) {
+            after[anchor].push_back(std::move(tracks[j]));
+        }
+    }
+
+    nlohmann::json kept = nlohmann::json::array();
+    const auto keep{[&kept](std::vector<nlohmann::json> &elements) {
+        for (nlohmann::json &element : elements) {
+            kept.push_back(std::move(element));
+        }
+    }};
+    std::vector<std::uint32_t> written(entries.size());
+    keep(after[0]);
+    for (std::size_t i{}; i < entries.size(); ++i) {
+        const std::uint32_t origin{entries[i].origin};
+        written[i] = static_cast<std::uint32_t>(kept.size());
+        if (origin < tracks.size() && tracks[origin].is_object()) {
+            kept.push_back(std::move(tracks[origin]));
+            kept.back()["path"] = entry(i);
+        } else {
+            kept.push_back(entry(i));
+        }
+        keep(after[i + 1]);
+    }
+    tracks = std::move(kept);
+
+    const std::filesystem::path tmp{std::filesystem::path{source} += ".tmp"};
+    {
+        std::ofstream out{tmp, std::ios::binary | std::ios::trunc};
+        require(out.is_open(), Error::FILE_WRITE);
+        out << root.dump(4, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+        require(static_cast<bool>(out.flush()), Error::FILE_WRITE);
+    }
+    std::filesystem::rename(tmp, source, ec);
+    require(!ec, Error::FILE_WRITE);
+
+    StringPool compacted{};
+    for (std::size_t i{}; i < entries.size(); ++i) {
+        PlaylistEntry &e{entries[i]};
+        e = {
+            .dir = compacted.intern(pool.view(e.dir)),
+            .file = compacted.intern(pool.view(e.file)),
+            .origin = written[i],
+        };
+    }
+    pool = std::move(compacted);
+    stamp = sourceStamp();
+    writeSnapshot();
+    journal.close();
+    std::filesystem::remove(journalPath, ec);
+    journalOps = 0;
+}
+
+PlayQueue::PlayQueue(const std::size_t count, const std::uint64_t seed) : rng{seed} { resize(count); }
+
+// Growing keeps the current pass: new tracks land in the unplayed tail. Shrinking starts a new pass.
+void PlayQueue::resize(const std::size_t count) {
+    std::erase_if(upNext, [count](const std::uint32_t idx) { return idx >= count; });
+    if (count >= order.size()) {
+        for (std::size_t i{order.size()}; i < count; ++i) {
+            order.push_back(static_cast<std::uint32_t>(i));
+        }
+        return;
+    }
+    order.resize(count);
+    std::iota(order.begin(), order.end(), 0u);
+    cursor = 0;
+}
+
+void PlayQueue::enqueue(const std::size_t idx) {
+    if (idx < order.size()) {
+        upNext.push_back(static_cast<std::uint32_t>(idx));
+    }
+}
+
+// Forgets a track removed from the library. Later indices shift down by one; the pass carries on where it was.
+void PlayQueue::remove(const std::size_t idx) {
+    const auto pos{std::find(order.begin(), order.end(), static_cast<std::uint32_t>(idx))};
+    if (pos == order.end()) {
+        return;
+    }
+    if (static_cast<std::size_t>(pos - order.begin()) < cursor) {
+        --cursor;
+    }
+    order.erase(pos);
+    std::erase(upNext, static_cast<std::uint32_t>(idx));
+    const auto shift{[idx](std::uint32_t &i) { i -= i > idx ? 1 : 0; }};
+    std::for_each(order.begin(), order.end(), shift);
+    std::for_each(upNext.begin(), upNext.end(), shift);
+}
+
+void PlayQueue::setShuffle(const bool value) {
+    shuffle = value;
+    cursor = 0;
+}
+
+// Returns nullopt at the end of the library, or of a shuffled pass; the following call begins a new pass.
+std::optional<std::size_t> PlayQueue::next(const std::size_t current) {
+    if (!upNext.empty()) {
+        const std::size_t idx{upNext.front()};
+        upNext.pop_front();
+        return idx;
+    }
+    if (!shuffle) {
+        return current + 1 < order.size() ? std::optional<std::size_t>{current + 1} : std::nullopt;
+    }
+    if (cursor == order.size()) {
+        cursor = 0;
+        return std::nullopt;
+    }
+    std::uniform_int_distribution<std::size_t> pick{cursor, order.size() - 1};
+    std::swap(order[cursor], order[pick(rng)]);
+    return order[cursor++];
+}
+
+std::optional<std::size_t> PlayQueue::previous(const std::size_t current) {
+    if (!shuffle) {
+        return current ? std::optional<std::size_t>{current - 1} : std::nullopt;
+    }
+    if (cursor < 2) {
+        return std::nullopt;
+    }
+    --cursor;
+    return order[cursor - 1];
+}
+
+} // namespace trm
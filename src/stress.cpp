@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "exporter.hpp"
+#include "maudio.hpp"
+#include "stress.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencySeries {
+    const char *name{};
+    std::vector<double> samples{};
+    std::size_t timeouts{};
+    void add(const std::optional<double> latency) {
+        if (latency) {
+            samples.push_back(*latency);
+        } else {
+            ++timeouts;
+        }
+    }
+    double percentile(const double p) const {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+    }
+};
+
+// Left carries the segment index and right its negation, so any queued sample tells where in the track it came from.
+void writeProbeTrack(const std::filesystem::path &path) {
+    constexpr std::size_t channels{MaDeviceSpecifiers::channels};
+    constexpr std::size_t frames{StressSpecifiers::trackSeconds * MaDeviceSpecifiers::sampleRate};
+    AlignedBuffer buffer{ExportOptions::minBufferSize};
+    WavWriter writer{path, buffer};
+    for (std::size_t frame{}; frame < frames;) {
+        std::int16_t *out{writer.writePtr()};
+        const std::size_t n{std::min(writer.writeCapacity() / channels, frames - frame)};
+        for (std::size_t i{}; i < n; ++i) {
+            const auto segment{static_cast<std::int16_t>((frame + i) / StressSpecifiers::segmentFrames)};
+            out[i * channels] = segment;
+            out[i * channels + 1] = static_cast<std::int16_t>(-segment);
+        }
+        writer.commit(n * channels);
+        frame += n;
+    }
+    writer.finish();
+}
+
+float segmentTime(const std::int16_t sample) {
+    return static_cast<float>(std::abs(sample) * StressSpecifiers::segmentFrames) / MaDeviceSpecifiers::sampleRate;
+}
+
+// Polls published snapshots until `done` accepts one. Returns microseconds since `sent`, or nullopt on timeout.
+template <typename Done>
+std::optional<double> awaitEffect(const AudioDevice &dev, const Clock::time_point sent, const Done &done) {
+    std::uint64_t version{};
+    while (Clock::now() - sent < StressSpecifiers::effectTimeout) {
+        const std::uint64_t current{dev.getSnapshotVersion()};
+        if (current != version) {
+            version = current;
+            if (done(dev.getSnapshot())) {
+                return std::chrono::duration<double, std::micro>(Clock::now() - sent).count();
+            }
+        }
+        std::this_thread::yield();
+    }
+    return std::nullopt;
+}
+
+// seekTo flushes the queue under its mutex before the decoder moves, so once the seek is visible every queued
+// sample must come from around the target.
+bool queueMatches(AudioDevice &dev, const float target) {
+    std::lock_guard<std::mutex> lock{dev.getQueueMutex()};
+    const std::queue<std::int16_t> &queue{dev.getQueue()};
+    const auto near{[target](const std::int16_t sample) {
+        return std::abs(segmentTime(sample) - target) <= StressSpecifiers::staleTolerance;
+    }};
+    return queue.empty() || (near(queue.front()) && near(queue.back()));
+}
+
+bool loopToggles(AudioDevice &dev) {
+    const bool looping{dev.getSnapshot().looping};
+    const Clock::time_point sent{Clock::now()};
+    dev.toggleLooping();
+    return awaitEffect(dev, sent, [looping](const PlayerSnapshot &s) { return s.looping != looping; }).has_value();
+}
+
+bool startTakesEffect(AudioDevice &dev, const std::filesystem::path &path, const bool ready) {
+    const std::uint64_t trackId{dev.getSnapshot().trackId};
+    const Clock::time_point sent{Clock::now()};
+    dev.start(path);
+    return awaitEffect(dev, sent, [trackId, ready](const PlayerSnapshot &s) {
+        return s.trackId > trackId && s.ready == ready;
+    }).has_value();
+}
+
+// Commands with no open stream behind them: a seek before anything was started, and a seek or loop after a start
+// that failed. pThread must shrug them off and still answer the valid start that follows.
+bool survivesMisuse(AudioDevice &dev, const std::filesystem::path &probe, const std::filesystem::path &dir) {
+    const std::filesystem::path garbage{dir / "garbage.wav"};
+    {
+        std::ofstream out{garbage, std::ios::binary};
+        for (std::size_t i{}; i < 1024; ++i) {
+            out << "not audio ";
+        }
+    }
+    dev.seekTo(1.0f);
+    bool ok{loopToggles(dev)};
+    for (const std::filesystem::path &bad : {dir / "missing.wav", garbage}) {
+        ok = startTakesEffect(dev, bad, false) && ok;
+        dev.seekTo(1.0f);
+        ok = loopToggles(dev) && ok;
+    }
+    return startTakesEffect(dev, probe, true) && ok;
+}
+
+// A torn snapshot read would surface as an impossible combination of fields.
+bool consistent(const PlayerSnapshot &snap, const std::string_view probe) {
+    if (snap.pathBytes > PlayerSnapshot::maxPathBytes) {
+        return false;
+    }
+    return !snap.ready || (std::string_view{snap.path.data(), snap.pathBytes} == probe && snap.timestamp >= 0.0f &&
+                           snap.timestamp <= snap.duration + 0.5f);
+}
+
+} // namespace
+
+bool runStress(const StressOptions &options) {
+    const std::string stamp{std::format("tmplay-stress-{}", Clock::now().time_since_epoch().count())};
+    const std::filesystem::path dir{std::filesystem::temp_directory_path() / stamp};
+    std::filesystem::create_directories(dir);
+    const std::filesystem::path probe{dir / "probe.wav"};
+    writeProbeTrack(probe);
+    const std::string probeU8{asU8(probe)};
+
+    bool misuse{};
+    bool started{};
+    std::uint64_t underruns{};
+    std::size_t stale{};
+    std::array<LatencySeries, 4> series{{{.name = "start"}, {.name = "seek"}, {.name = "loop"}, {.name = "end"}}};
+    std::atomic<std::uint64_t> commands{};
+    std::atomic<std::uint64_t> torn{};
+    std::uint64_t dropped{};
+    bool recovered{};
+    {
+        AudioDevice dev{ma_backend_null};
+        dev.setEqEnabled(false);
+        dev.setVol(1.0f);
+        dev.play();
+        misuse = survivesMisuse(dev, probe, dir);
+        if (dev.getSnapshot().looping) {
+            dev.toggleLooping();
+        }
+
+        // Steady playback first: only pThread and the device callback are busy, so any underrun is a real one.
+        // Counting starts once the warmup's worth of audio has been decoded rather than after a fixed sleep, so a
+        // slow start on a loaded or sanitized run stays out of the window.
+        const std::uint64_t misuseTrack{dev.getSnapshot().trackId};
+        Clock::time_point sent{Clock::now()};
+        dev.start(probe);
+        const float warm{std::chrono::duration<float>(StressSpecifiers::warmup).count()};
+        started = awaitEffect(dev, sent, [misuseTrack](const PlayerSnapshot &s) {
+                      return s.trackId > misuseTrack && s.ready;
+                  }).has_value() &&
+                  awaitEffect(dev, Clock::now(), [warm](const PlayerSnapshot &s) {
+                      return s.ready && s.timestamp >= warm;
+                  }).has_value();
+        if (started) {
+            const std::uint64_t before{dev.getSnapshot().underruns};
+            std::this_thread::sleep_for(StressSpecifiers::steady);
+            underruns = dev.getSnapshot().underruns - before;
+        }
+
+        // Sequential round trips, one command in flight at a time.
+        std::mt19937 rng{1};
+        std::uniform_real_distribution<float> position{1.0f, StressSpecifiers::trackSeconds - 10.0f};
+        for (std::size_t i{}; started && i < options.iterations; ++i) {
+            const std::uint64_t trackId{dev.getSnapshot().trackId};
+            sent = Clock::now();
+            dev.start(probe);
+            series[0].add(awaitEffect(dev, sent, [trackId](const PlayerSnapshot &s) {
+                return s.trackId > trackId && s.ready;
+            }));
+
+            float target{position(rng)};
+            while (std::abs(target - dev.getSnapshot().timestamp) < StressSpecifiers::minSeekDistance) {
+                target = position(rng);
+            }
+            sent = Clock::now();
+            dev.seekTo(target);
+            const std::optional<double> seek{awaitEffect(dev, sent, [target](const PlayerSnapshot &s) {
+                return s.ready && std::abs(s.timestamp - target) <= StressSpecifiers::staleTolerance;
+            })};
+            series[1].add(seek);
+            if (seek && !queueMatches(dev, target)) {
+                ++stale;
+            }
+
+            const bool looping{dev.getSnapshot().looping};
+            sent = Clock::now();
+            dev.toggleLooping();
+            series[2].add(awaitEffect(dev, sent, [looping](const PlayerSnapshot &s) { return s.looping != looping; }));
+
+            sent = Clock::now();
+            dev.end();
+            series[3].add(awaitEffect(dev, sent, [](const PlayerSnapshot &s) { return !s.ready; }));
+        }
+
+        // Unpaced commands from every thread while a reader checks each published snapshot.
+        const std::uint64_t droppedBefore{dev.getSnapshot().droppedCommands};
+        std::atomic<bool> stop{};
+        std::thread reader{[&] {
+            std::uint64_t lastVersion{};
+            while (!stop.load()) {
+                const std::uint64_t version{dev.getSnapshotVersion()};
+                if (version < lastVersion || !consistent(dev.getSnapshot(), probeU8)) {
+                    ++torn;
+                }
+                lastVersion = version;
+                std::this_thread::yield();
+            }
+        }};
+        const Clock::time_point deadline{Clock::now() + options.hammer};
+        std::vector<std::thread> workers{};
+        for (std::size_t w{}; started && w < options.threads; ++w) {
+            workers.emplace_back([&, w] {
+                std::mt19937 local{static_cast<unsigned int>(w + 1)};
+                std::uniform_int_distribution<int> roll{0, 9};
+                std::uniform_real_distribution<float> at{0.0f, static_cast<float>(StressSpecifiers::trackSeconds)};
+                std::uint64_t issued{};
+                while (Clock::now() < deadline) {
+                    const int op{roll(local)};
+                    if (op < 4) {
+                        dev.seekTo(at(local));
+                    } else if (op < 6) {
+                        dev.toggleLooping();
+                    } else if (op < 8) {
+                        dev.start(probe);
+                    } else {
+                        dev.end();
+                    }
+                    ++issued;
+                    std::this_thread::yield();
+                }
+                commands += issued;
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        stop = true;
+        reader.join();
+        dropped = dev.getSnapshot().droppedCommands - droppedBefore;
+
+        // The device must still answer once the storm is over: no lost wakeups, no wedged locks.
+        if (started) {
+            const std::uint64_t trackId{dev.getSnapshot().trackId};
+            sent = Clock::now();
+            dev.start(probe);
+            recovered = awaitEffect(dev, sent, [trackId](const PlayerSnapshot &s) {
+                            return s.trackId > trackId && s.ready;
+                        }).has_value();
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::remove_all(dir, ec);
+
+    bool passed{misuse && started && recovered && !underruns && !stale && !torn.load()};
+    std::cout << "op    | samples |  p50 us |  p99 us | p999 us |  max us | timeouts\n";
+    for (LatencySeries &s : series) {
+        std::sort(s.samples.begin(), s.samples.end());
+        const bool tail{s.samples.size() >= StressSpecifiers::minTailSamples};
+        const std::string p999{tail ? std::format("{:7.0f}", s.percentile(0.999)) : std::string{"      -"}};
+        std::cout << std::format(
+            "{:5} | {:7} | {:7.0f} | {:7.0f} | {} | {:7.0f} | {}\n", s.name, s.samples.size(), s.percentile(0.5),
+            s.percentile(0.99), p999, s.samples.empty() ? 0.0 : s.samples.back(), s.timeouts
+        );
+        passed = passed && !s.timeouts;
+    }
+    std::cout << std::format(
+        "misuse | seek and loop without a stream {}\n"
+        "steady | {} underruns over {} ms\n"
+        "seek   | {} stale of {}\n"
+        "hammer | {} threads, {} commands, {} dropped, {} torn snapshots, {}\n"
+        "result | {}\n",
+        misuse ? "survived" : "unanswered", underruns, StressSpecifiers::steady.count(), stale,
+        series[1].samples.size(), options.threads, commands.load(), dropped, torn.load(),
+        recovered ? "recovered" : "unresponsive", passed ? "PASS" : "FAIL"
+    );
+    return passed;
+}
+
+} // namespace trm
@@ -0,0 +1,35 @@
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "stress.hpp"
+#include "utils.hpp"
+
+// tmplay_stress [-j <threads>] [-n <iterations>] [-s <seconds>]
+int main(int argc, char **argv) {
+    std::ios_base::sync_with_stdio(false);
+    try {
+        trm::StressOptions opts{};
+        for (int i{1}; i < argc; i += 2) {
+            const std::string_view arg{argv[i]};
+            trm::require(i + 1 < argc, trm::Error::INVALID_ARGUMENT);
+            const std::size_t value{static_cast<std::size_t>(std::stoull(argv[i + 1]))};
+            if (arg == "-j") {
+                opts.threads = value;
+            } else if (arg == "-n") {
+                opts.iterations = value;
+            } else if (arg == "-s") {
+                opts.hammer = std::chrono::seconds{value};
+            } else {
+                trm::require(false, trm::Error::INVALID_ARGUMENT);
+            }
+        }
+        return trm::runStress(opts) ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
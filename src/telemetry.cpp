@@ -0,0 +1,415 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "telemetry.hpp"
+#include "utils.hpp"
+
+namespace trm {
+
+namespace {
+
+struct LogHeader {
+    std::uint32_t magic{TelemetrySpecifiers::logMagic};
+    std::uint32_t version{TelemetrySpecifiers::version};
+    std::uint64_t epoch{};
+};
+
+struct NamesHeader {
+    std::uint32_t magic{TelemetrySpecifiers::namesMagic};
+    std::uint32_t version{TelemetrySpecifiers::version};
+};
+
+struct AggregateHeader {
+    std::uint32_t magic{TelemetrySpecifiers::aggregateMagic};
+    std::uint32_t version{TelemetrySpecifiers::version};
+    std::uint64_t epoch{};
+    std::uint64_t count{};
+};
+
+template <typename T> bool readPod(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template <typename T> void writePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+bool readString(std::istream &in, std::string &value) {
+    std::uint32_t length{};
+    if (!readPod(in, length) || length > TelemetrySpecifiers::maxNameBytes) {
+        return false;
+    }
+    value.resize(length);
+    return static_cast<bool>(in.read(value.data(), length));
+}
+
+void writeString(std::ostream &out, const std::string &value) {
+    writePod(out, static_cast<std::uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+// Drops a torn tail left by an interrupted append so later records stay aligned.
+void truncateTo(const std::filesystem::path &file, const std::uintmax_t size) {
+    std::error_code ec{};
+    if (std::filesystem::file_size(file, ec) != size && !ec) {
+        std::filesystem::resize_file(file, size, ec);
+    }
+}
+
+} // namespace
+
+PlaybackTelemetry::PlaybackTelemetry(std::filesystem::path dir) : directory{std::move(dir)} {
+    std::error_code ec{};
+    std::filesystem::create_directories(directory, ec);
+    load();
+    flusher = std::thread([this] { this->flusherThread(); });
+}
+
+PlaybackTelemetry::~PlaybackTelemetry() {
+    {
+        std::lock_guard<std::mutex> lock{waitMutex};
+        terminate = true;
+    }
+    condition.notify_one();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    flush();
+}
+
+std::uint64_t PlaybackTelemetry::now() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count()
+    );
+}
+
+void PlaybackTelemetry::emit(const PlaybackEvent &event) {
+    if (!buffer.push(event)) [[unlikely]] {
+        ++dropped;
+    }
+}
+
+void PlaybackTelemetry::nameTrack(const std::uint64_t track, std::string u8) {
+    if (!pendingNames.push({track, std::move(u8)})) [[unlikely]] {
+        ++dropped;
+    }
+}
+
+// Aggregates come from the last snapshot, then any log written in the same or a later epoch is replayed.
+// A log from an older epoch was already folded in by a compaction that did not get to truncate it.
+void PlaybackTelemetry::load() {
+    const std::filesystem::path aggPath{directory / "aggregates.bin"};
+    const std::filesystem::path logPath{directory / "events.log"};
+    const std::filesystem::path namesPath{directory / "names.log"};
+    {
+        std::ifstream in{aggPath, std::ios::binary};
+        AggregateHeader header{};
+        if (readPod(in, header) && header.magic == TelemetrySpecifiers::aggregateMagic &&
+            header.version == TelemetrySpecifiers::version) {
+            epoch = header.epoch;
+            // The count is only trusted as far as the file could actually hold that many records.
+            constexpr std::size_t minRecordBytes{sizeof(std::uint64_t) + sizeof(TrackStats) + sizeof(std::uint32_t)};
+            std::error_code ec{};
+            const std::uintmax_t fileBytes{std::filesystem::file_size(aggPath, ec)};
+            const std::uint64_t fits{ec ? 0 : (fileBytes - sizeof(AggregateHeader)) / minRecordBytes};
+            aggregates.reserve(std::min(header.count, fits));
+            for (std::uint64_t i{}; i < std::min(header.count, fits); ++i) {
+                std::uint64_t track{};
+                TrackStats stats{};
+                std::string name{};
+                if (!readPod(in, track) || !readPod(in, stats) || !readString(in, name)) {
+                    break;
+                }
+                aggregates[track] = stats;
+                if (!name.empty()) {
+                    names[track] = std::move(name);
+                }
+            }
+        }
+    }
+    {
+        std::ifstream in{namesPath, std::ios::binary};
+        NamesHeader header{};
+        if (readPod(in, header) && header.magic == TelemetrySpecifiers::namesMagic) {
+            std::streamoff good{in.tellg()};
+            std::uint64_t track{};
+            std::string name{};
+            while (readPod(in, track) && readString(in, name)) {
+                names[track] = name;
+                good = in.tellg();
+            }
+            in.close();
+            truncateTo(namesPath, static_cast<std::uintmax_t>(good));
+        }
+    }
+    bool replayed{};
+    {
+        std::ifstream in{logPath, std::ios::binary};
+        LogHeader header{};
+        if (readPod(in, header) && header.magic == TelemetrySpecifiers::logMagic &&
+            header.version == TelemetrySpecifiers::version && header.epoch >= epoch) {
+            epoch = header.epoch;
+            std::vector<PlaybackEvent> chunk(4096);
+            while (in) {
+                in.read(reinterpret_cast<char *>(chunk.data()), chunk.size() * sizeof(PlaybackEvent));
+                const std::size_t got{static_cast<std::size_t>(in.gcount()) / sizeof(PlaybackEvent)};
+                chunk.resize(got);
+                apply(chunk);
+                logEvents += got;
+                chunk.resize(4096);
+            }
+            in.close();
+            truncateTo(logPath, sizeof(LogHeader) + logEvents * sizeof(PlaybackEvent));
+            replayed = true;
+        }
+    }
+    if (!replayed) {
+        resetLogs();
+        return;
+    }
+    eventLog.open(logPath, std::ios::binary | std::ios::app);
+    nameLog.open(namesPath, std::ios::binary | std::ios::app);
+    if (!std::filesystem::exists(namesPath) || std::filesystem::file_size(namesPath) == 0) {
+        writePod(nameLog, NamesHeader{});
+    }
+}
+
+// Starts empty logs for the current epoch.
+void PlaybackTelemetry::resetLogs() {
+    eventLog.close();
+    nameLog.close();
+    eventLog.open(directory / "events.log", std::ios::binary | std::ios::trunc);
+    nameLog.open(directory / "names.log", std::ios::binary | std::ios::trunc);
+    writePod(eventLog, LogHeader{.epoch = epoch});
+    writePod(nameLog, NamesHeader{});
+    eventLog.flush();
+    nameLog.flush();
+    logEvents = 0;
+}
+
+// Not thread-safe. Must be used within ioMutex.
+void PlaybackTelemetry::persist(
+    const std::vector<PlaybackEvent> &events, const std::vector<std::pair<std::uint64_t, std::string>> &n
+) {
+    {
+        std::unique_lock<std::shared_mutex> lock{statsMutex};
+        for (const auto &[track, name] : n) {
+            std::string &known{names[track]};
+            if (known != name) {
+                known = name;
+                writePod(nameLog, track);
+                writeString(nameLog, name);
+            }
+        }
+    }
+    const std::size_t bytes{events.size() * sizeof(PlaybackEvent)};
+    eventLog.write(reinterpret_cast<const char *>(events.data()), static_cast<std::streamsize>(bytes));
+    eventLog.flush();
+    nameLog.flush();
+    logEvents += events.size();
+}
+
+void PlaybackTelemetry::apply(const std::vector<PlaybackEvent> &events) {
+    std::unique_lock<std::shared_mutex> lock{statsMutex};
+    for (const PlaybackEvent &event : events) {
+        TrackStats &stats{aggregates[event.track]};
+        const float ratio{event.value > 0.0f ? std::clamp(event.position / event.value, 0.0f, 1.0f) : 1.0f};
+        switch (event.type) {
+        case PlaybackEventType::START:
+            ++stats.plays;
+            stats.lastPlayed = std::max(stats.lastPlayed, event.time);
+            break;
+        case PlaybackEventType::END:
+            ++stats.completions;
+            stats.completionSum += ratio;
+            break;
+        case PlaybackEventType::SKIP:
+            ++stats.skips;
+            stats.completionSum += ratio;
+            break;
+        case PlaybackEventType::SEEK: ++stats.seeks; break;
+        case PlaybackEventType::LOOP:
+            ++stats.plays;
+            ++stats.completions;
+            stats.completionSum += 1.0f;
+            stats.lastPlayed = std::max(stats.lastPlayed, event.time);
+            break;
+        }
+    }
+}
+
+// Drains the lock-free buffers to disk and into the aggregates.
+void PlaybackTelemetry::flush() {
+    std::lock_guard<std::mutex> lock{ioMutex};
+    std::vector<PlaybackEvent> events{};
+    std::vector<std::pair<std::uint64_t, std::string>> n{};
+    while (std::optional<std::pair<std::uint64_t, std::string>> name{pendingNames.pop()}) {
+        n.push_back(std::move(*name));
+    }
+    while (std::optional<PlaybackEvent> event{buffer.pop()}) {
+        events.push_back(*event);
+    }
+    if (events.empty() && n.empty()) {
+        return;
+    }
+    persist(events, n);
+    apply(events);
+    if (logEvents >= TelemetrySpecifiers::compactThreshold) {
+        compactLocked();
+    }
+}
+
+// Synchronous bulk append. For imports and benchmarks.
+void PlaybackTelemetry::ingest(const std::vector<PlaybackEvent> &events) {
+    std::lock_guard<std::mutex> lock{ioMutex};
+    persist(events, {});
+    apply(events);
+    if (logEvents >= TelemetrySpecifiers::compactThreshold) {
+        compactLocked();
+    }
+}
+
+void PlaybackTelemetry::compact() {
+    std::lock_guard<std::mutex> lock{ioMutex};
+    compactLocked();
+}
+
+// Not thread-safe. Must be used within ioMutex.
+// The snapshot is written under the next epoch and renamed into place before the logs are reset.
+void PlaybackTelemetry::compactLocked() {
+    const std::filesystem::path tmpPath{directory / "aggregates.tmp"};
+    {
+        std::ofstream out{tmpPath, std::ios::binary | std::ios::trunc};
+        std::shared_lock<std::shared_mutex> lock{statsMutex};
+        writePod(out, AggregateHeader{.epoch = epoch + 1, .count = aggregates.size()});
+        for (const auto &[track, stats] : aggregates) {
+            const auto name{names.find(track)};
+            writePod(out, track);
+            writePod(out, stats);
+            writeString(out, name != names.end() ? name->second : std::string{});
+        }
+        if (!out.flush()) {
+            return;
+        }
+    }
+    std::error_code ec{};
+    std::filesystem::rename(tmpPath, directory / "aggregates.bin", ec);
+    if (ec) {
+        return;
+    }
+    ++epoch;
+    resetLogs();
+}
+
+std::optional<TrackStats> PlaybackTelemetry::query(const std::uint64_t track) const {
+    std::shared_lock<std::shared_mutex> lock{statsMutex};
+    const auto it{aggregates.find(track)};
+    return it != aggregates.end() ? std::optional<TrackStats>{it->second} : std::nullopt;
+}
+
+// "For You" ordering: favours tracks played often and to completion, decaying with time since last play.
+std::vector<RankedTrack> PlaybackTelemetry::rank(const std::size_t count, const std::uint64_t at) const {
+    constexpr double halfLifeMs{TelemetrySpecifiers::recencyHalfLifeDays * 86'400'000.0};
+    std::vector<RankedTrack> ranked{};
+    {
+        std::shared_lock<std::shared_mutex> lock{statsMutex};
+        ranked.reserve(aggregates.size());
+        for (const auto &[track, stats] : aggregates) {
+            const double age{at > stats.lastPlayed ? static_cast<double>(at - stats.lastPlayed) : 0.0};
+            const double score{
+                std::log2(1.0 + stats.plays) * (0.25 + stats.completionRatio()) * std::exp2(-age / halfLifeMs)
+            };
+            ranked.push_back(RankedTrack{.track = track, .score = score});
+        }
+    }
+    const std::size_t n{std::min(count, ranked.size())};
+    std::partial_sort(
+        ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(n), ranked.end(),
+        [](const RankedTrack &a, const RankedTrack &b) { return a.score > b.score; }
+    );
+    ranked.resize(n);
+    return ranked;
+}
+
+std::string PlaybackTelemetry::trackName(const std::uint64_t track) const {
+    std::shared_lock<std::shared_mutex> lock{statsMutex};
+    const auto it{names.find(track)};
+    return it != names.end() ? it->second : std::string{};
+}
+
+std::size_t PlaybackTelemetry::trackCount() const {
+    std::shared_lock<std::shared_mutex> lock{statsMutex};
+    return aggregates.size();
+}
+
+void PlaybackTelemetry::flusherThread() {
+    std::unique_lock<std::mutex> lock{waitMutex};
+    while (!terminate) {
+        condition.wait_for(lock, TelemetrySpecifiers::flushInterval, [this] { return this->terminate; });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+std::vector<PlaybackEvent> synthesizeHistory(
+    const std::size_t tracks, const double years, const std::uint64_t endTime, const unsigned int seed,
+    const std::size_t sessionsPerDay
+) {
+    constexpr std::uint64_t dayMs{86'400'000};
+    std::mt19937_64 rng{seed};
+    std::vector<std::uint64_t> ids(tracks);
+    std::vector<double> weights(tracks);
+    for (std::size_t i{}; i < tracks; ++i) {
+        ids[i] = fnv1a(std::format("synthetic/{:06}.flac", i));
+        weights[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    std::discrete_distribution<std::size_t> pick{weights.begin(), weights.end()};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+    std::uniform_real_distribution<float> length{120.0f, 420.0f};
+
+    const std::uint64_t sessions{static_cast<std::uint64_t>(years * 365.0) * sessionsPerDay};
+    const std::uint64_t step{dayMs / std::max<std::size_t>(1, sessionsPerDay)};
+    std::uint64_t time{endTime - sessions * step};
+    std::vector<PlaybackEvent> events{};
+    events.reserve(sessions * 3);
+    const auto push{[&](const std::uint64_t at, const std::uint64_t track, const float position, const float value,
+                        const PlaybackEventType type) {
+        events.push_back({.time = at, .track = track, .position = position, .value = value, .type = type});
+    }};
+    for (std::uint64_t s{}; s < sessions; ++s) {
+        time += step;
+        const std::uint64_t track{ids[pick(rng)]};
+        const float duration{length(rng)};
+        push(time, track, 0.0f, duration, PlaybackEventType::START);
+        float position{};
+        if (unit(rng) < 0.15f) {
+            const float target{unit(rng) * duration};
+            push(time + 1000, track, position, target, PlaybackEventType::SEEK);
+            position = target;
+        }
+        const float roll{unit(rng)};
+        if (roll < 0.25f) {
+            position += unit(rng) * (duration - position);
+            push(time + 2000, track, position, duration, PlaybackEventType::SKIP);
+        } else if (roll < 0.30f) {
+            push(time + 2000, track, duration, duration, PlaybackEventType::LOOP);
+        } else {
+            push(time + 2000, track, duration, duration, PlaybackEventType::END);
+        }
+    }
+    return events;
+}
+
+} // namespace trm
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cstddef>
+
+#include "threadpool.hpp"
+
+namespace trm {
+
+ThreadPool::ThreadPool(const std::size_t threads) {
+    const std::size_t count{std::max<std::size_t>(1, threads)};
+    queues.reserve(count);
+    for (std::size_t i{}; i < count; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    workers.reserve(count);
+    for (std::size_t i{}; i < count; ++i) {
+        workers.emplace_back([this, i] { this->workerThread(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock{idleMutex};
+        terminate.store(true);
+    }
+    idleCondition.notify_all();
+    for (std::thread &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::submit(PoolTask task) {
+    WorkerQueue &queue{*queues[nextQueue.fetch_add(1) % queues.size()]};
+    {
+        // Counted first so a task cannot be finished before it is accounted for.
+        std::lock_guard<std::mutex> lock{idleMutex};
+        pending.fetch_add(1);
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        queue.tasks.push_back(std::move(task));
+    }
+    idleCondition.notify_one();
+}
+
+// Blocks until every submitted task has finished executing.
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock{idleMutex};
+    doneCondition.wait(lock, [this] { return this->pending.load() == 0; });
+}
+
+bool ThreadPool::popLocal(const std::size_t idx, PoolTask &task) {
+    WorkerQueue &queue{*queues[idx]};
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued.fetch_sub(1);
+    return true;
+}
+
+// Victim locks are taken blocking: a skipped busy queue would leave `queued` non-zero with nothing to show for it,
+// and the idle wait would then spin instead of sleeping.
+bool ThreadPool::steal(const std::size_t idx, PoolTask &task) {
+    for (std::size_t offset{1}; offset < queues.size(); ++offset) {
+        WorkerQueue &victim{*queues[(idx + offset) % queues.size()]};
+        std::lock_guard<std::mutex> lock{victim.mutex};
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerThread(const std::size_t idx) {
+    PoolTask task{};
+    while (!terminate.load()) {
+        if (popLocal(idx, task) || steal(idx, task)) {
+            task(idx);
+            task = nullptr;
+            std::lock_guard<std::mutex> lock{idleMutex};
+            if (pending.fetch_sub(1) == 1) {
+                doneCondition.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock{idleMutex};
+        idleCondition.wait(lock, [this] { return this->terminate.load() || this->queued.load() != 0; });
+    }
+}
+
+} // namespace trm
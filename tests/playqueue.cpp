@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "playlist.hpp"
+
+namespace {
+
+std::size_t failures{};
+
+void check(const bool cond, const char *what) {
+    if (!cond) {
+        ++failures;
+        std::cerr << "FAILED: " << what << '\n';
+    }
+}
+
+// Queued tracks behind a removed one shift down with the library; the removed one is dropped.
+void removeShiftsUpNext() {
+    trm::PlayQueue queue{5, 1};
+    queue.enqueue(3);
+    queue.enqueue(4);
+    queue.enqueue(1);
+    queue.remove(3);
+    check(queue.queued() == 2, "removed track leaves the up-next queue");
+    check(queue.next(0) == std::optional<std::size_t>{3}, "up-next index above the removal shifts down");
+    check(queue.next(0) == std::optional<std::size_t>{1}, "up-next index below the removal is kept");
+    check(queue.next(3) == std::nullopt, "order shrinks with the library");
+}
+
+// A shuffled pass interrupted by removals still visits every remaining track exactly once, and never past the end.
+void removeKeepsShufflePass() {
+    constexpr std::size_t count{8};
+    trm::PlayQueue queue{count, 7};
+    queue.setShuffle(true);
+    std::vector<std::size_t> played{};
+    for (std::size_t i{}; i < 3; ++i) {
+        played.push_back(*queue.next(0));
+    }
+    const std::size_t gonePlayed{played[1]};
+    queue.remove(gonePlayed);
+    std::vector<bool> seen(count - 1);
+    for (const std::size_t idx : played) {
+        if (idx != gonePlayed) {
+            seen[idx > gonePlayed ? idx - 1 : idx] = true;
+        }
+    }
+    const std::size_t goneUnplayed{static_cast<std::size_t>(std::find(seen.begin(), seen.end(), false) - seen.begin())};
+    queue.remove(goneUnplayed);
+    seen.erase(seen.begin() + static_cast<std::ptrdiff_t>(goneUnplayed));
+    std::size_t drawn{};
+    while (const std::optional<std::size_t> idx{queue.next(0)}) {
+        check(*idx < seen.size(), "shuffle stays inside the library");
+        check(*idx < seen.size() && !seen[*idx], "shuffle does not repeat within a pass");
+        if (*idx < seen.size()) {
+            seen[*idx] = true;
+        }
+        ++drawn;
+    }
+    check(drawn == count - 2 - 2, "shuffle pass covers the remaining unplayed tracks");
+    check(std::all_of(seen.begin(), seen.end(), [](const bool s) { return s; }), "every track is played once");
+}
+
+void removeOutOfRangeIsIgnored() {
+    trm::PlayQueue queue{2, 1};
+    queue.enqueue(1);
+    queue.remove(5);
+    check(queue.queued() == 1, "out-of-range removal is a no-op");
+}
+
+} // namespace
+
+int main() {
+    removeShiftsUpNext();
+    removeKeepsShufflePass();
+    removeOutOfRangeIsIgnored();
+    std::cout << (failures ? "FAIL" : "PASS") << '\n';
+    return failures ? 1 : 0;
+}